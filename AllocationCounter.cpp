@@ -0,0 +1,141 @@
+#include "AllocationCounter.h"
+
+#ifdef BLOCKFALL_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+// Plain thread_local integers need no constructor, so the first count cannot recurse into new
+static thread_local unsigned long thread_allocations = 0;
+static thread_local unsigned long thread_bytes = 0;
+
+static void *counted_allocate(size_t size, size_t alignment) {
+    thread_allocations++;
+    thread_bytes += size;
+    if (size == 0) {
+        size = 1;
+    }
+    void *p;
+    if (alignment <= alignof(max_align_t)) {
+        p = malloc(size);
+    } else {
+        // aligned_alloc wants a multiple of the alignment
+        p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    return p;
+}
+
+static void *checked(void *p) {
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(size_t size) {
+    return checked(counted_allocate(size, 0));
+}
+
+void *operator new[](size_t size) {
+    return checked(counted_allocate(size, 0));
+}
+
+void *operator new(size_t size, align_val_t alignment) {
+    return checked(counted_allocate(size, (size_t) alignment));
+}
+
+void *operator new[](size_t size, align_val_t alignment) {
+    return checked(counted_allocate(size, (size_t) alignment));
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept {
+    return counted_allocate(size, 0);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+    return counted_allocate(size, 0);
+}
+
+void *operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept {
+    return counted_allocate(size, (size_t) alignment);
+}
+
+void *operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept {
+    return counted_allocate(size, (size_t) alignment);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, size_t, align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, const nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, const nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, align_val_t, const nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, align_val_t, const nothrow_t &) noexcept {
+    free(p);
+}
+
+bool AllocationCounter::enabled() {
+    return true;
+}
+
+unsigned long AllocationCounter::allocations() {
+    return thread_allocations;
+}
+
+unsigned long AllocationCounter::bytes() {
+    return thread_bytes;
+}
+
+#else
+
+bool AllocationCounter::enabled() {
+    return false;
+}
+
+unsigned long AllocationCounter::allocations() {
+    return 0;
+}
+
+unsigned long AllocationCounter::bytes() {
+    return 0;
+}
+
+#endif // BLOCKFALL_COUNT_ALLOCATIONS
@@ -0,0 +1,19 @@
+#ifndef PA2_ALLOCATIONCOUNTER_H
+#define PA2_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+using namespace std;
+
+// Heap allocation counts for the calling thread. Counting replaces the global operator new and
+// delete, so it is only compiled in with -DBLOCKFALL_COUNT_ALLOCATIONS. Without it enabled() is
+// false and the counts stay at 0. Memory taken with malloc directly (C stdio, zlib) is not seen.
+namespace AllocationCounter {
+    bool enabled();
+
+    unsigned long allocations(); // operator new calls made by this thread so far
+
+    unsigned long bytes();       // Bytes requested by those calls
+}
+
+#endif //PA2_ALLOCATIONCOUNTER_H
@@ -4,10 +4,14 @@
 #define occupiedCellChar "██"
 #define unoccupiedCellChar "▒▒"
 
+#include <memory>
 #include <vector>
 #include <string>
 
 #include "Block.h"
+#include "BoardFeatures.h"
+#include "GameSetup.h"
+#include "Grid.h"
 #include "LeaderboardEntry.h"
 #include "Leaderboard.h"
 
@@ -18,13 +22,18 @@ public:
 
     BlockFall(string grid_file_name, string blocks_file_name, bool gravity_mode_on, const string &leaderboard_file_name,
               const string &player_name);
+    // Starts a game from an already parsed setup. An empty leaderboard_file_name skips the leaderboard file.
+    BlockFall(shared_ptr<const GameSetup> game_setup, bool gravity_mode_on, const string &leaderboard_file_name,
+              const string &player_name);
     virtual ~BlockFall();
 
+    shared_ptr<const GameSetup> setup; // Parsed grid and blocks this game started from (shared, read-only)
+
     int rows;  // Number of rows in the grid
     int cols;  // Number of columns in the grid
-    vector<vector<int> > grid;  // 2D game grid
+    Grid grid;  // 2D game grid (flat, row-major)
     vector<vector<bool>> power_up; // 2D matrix of the power-up shape
-    Block * initial_block = nullptr; // Head of the list of game blocks. Must be filled up and initialized after a call to read_blocks()
+    Block * initial_block = nullptr; // Head of the list of game blocks, owned by the setup
     Block * active_rotation = nullptr; // Currently active rotation of the active block. Must start with the initial_block
     bool gravity_mode_on = false; // Gravity mode of the game
     unsigned long current_score = 0; // Current score of the game
@@ -37,13 +46,19 @@ public:
     int active_rotation_index = 0; // Rotation index of the active block (0 to 3)
     bool game_over = false;
 
-    void initialize_grid(const string & input_file); // Initializes the grid using the command-line argument 1 in main
-    void read_blocks(const string & input_file); // Reads the input file and calls the read_block() function for each block;
-    static vector<vector<bool>> rotate_block(const vector<vector<bool>>& block);
+    // Cells changed since each post-drop pass last ran. A pass only needs to look at its own
+    // region; everything outside it is known to be settled / not full / not a power-up match.
+    DirtyRegion dirty_rows;     // Rows that may have become full since the last completed-row check
+    DirtyRegion dirty_power_up; // Cells changed since the last power-up search
+    DirtyRegion dirty_gravity;  // Columns that may not be settled since the last gravity pass
+    DirtyRegion dirty_trace;    // Cells changed since the trace last wrote the grid
+    DirtyRegion dirty_screen;   // Cells changed since the interactive frame was last drawn
 
-    Block *create_rotations(const vector<vector<bool>> &shape);
+    BoardFeatures features; // Heights, holes, bumpiness, wells and row fills, kept in step with the grid
 
-    int get_grid_cell(int x, int y) const;
+    int get_grid_cell(int x, int y) const {
+        return grid.get(y, x);
+    }
 
     void rotate_active_block(bool clockwise);
 
@@ -51,6 +66,10 @@ public:
 
     bool has_next_block_2(BlockFall &game) const;
 
+    void mark_dirty(int row_begin, int row_end, int col_begin, int col_end);
+
+    void mark_all_dirty(); // Full-scan fallback, e.g. after the gravity mode changes
+
 };
 
 
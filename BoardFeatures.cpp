@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include "BoardFeatures.h"
+
+void BoardFeatures::reset(const Grid &grid) {
+    rows = grid.rows;
+    cols = grid.cols;
+    heights.assign(cols, 0);
+    filled.assign(cols, 0);
+    wells.assign(cols, 0);
+    row_counts.assign(rows, 0);
+    scratch.reserve(rows + 1); // Sized once, so the updates never allocate
+    height_sum = filled_sum = bumpiness_sum = well_total = 0;
+
+    // Rows are visited top-down, so the first filled row seen in a column is its top
+    vector<int> top_row(cols, -1);
+    vector<int> column_counts(cols, 0);
+    grid.for_each_occupied_row([&](int r) {
+        for (int c = 0; c < cols; ++c) {
+            if (grid.get(r, c) != 0) {
+                row_counts[r]++;
+                column_counts[c]++;
+                if (top_row[c] < 0) {
+                    top_row[c] = r;
+                }
+            }
+        }
+    });
+    for (int c = 0; c < cols; ++c) {
+        set_filled(c, column_counts[c]);
+        set_height(c, top_row[c] < 0 ? 0 : rows - top_row[c]);
+    }
+    for (int c = 0; c < cols; ++c) {
+        update_well(c);
+    }
+}
+
+int BoardFeatures::neighbour_height(int c) const {
+    return c < 0 || c >= cols ? rows : heights[c];
+}
+
+void BoardFeatures::update_well(int c) {
+    if (c < 0 || c >= cols) {
+        return;
+    }
+    int depth = max(0, min(neighbour_height(c - 1), neighbour_height(c + 1)) - heights[c]);
+    well_total += depth - wells[c];
+    wells[c] = depth;
+}
+
+void BoardFeatures::set_height(int c, int height) {
+    // Only the bumpiness terms and wells next to column c depend on its height
+    if (c > 0) {
+        bumpiness_sum -= abs(heights[c - 1] - heights[c]);
+        bumpiness_sum += abs(heights[c - 1] - height);
+    }
+    if (c + 1 < cols) {
+        bumpiness_sum -= abs(heights[c + 1] - heights[c]);
+        bumpiness_sum += abs(heights[c + 1] - height);
+    }
+    height_sum += height - heights[c];
+    heights[c] = height;
+    update_well(c - 1);
+    update_well(c);
+    update_well(c + 1);
+}
+
+void BoardFeatures::set_filled(int c, int count) {
+    filled_sum += count - filled[c];
+    filled[c] = count;
+}
+
+void BoardFeatures::cell_filled(int r, int c) {
+    row_counts[r]++;
+    set_filled(c, filled[c] + 1);
+    if (rows - r > heights[c]) {
+        set_height(c, rows - r);
+    }
+}
+
+void BoardFeatures::rows_removed(const Grid &grid, int row_begin, int row_end) {
+    // Replays the row packing on the row counts (see pack_rows in GridKernels): rows that were
+    // full go, the rest move down, and the freed rows on top become copies of row 0, or empty
+    // if row 0 itself was full
+    auto was_full = [&](int r) {
+        return r >= row_begin && r < row_end && row_counts[r] == cols;
+    };
+    bool top_full = was_full(0);
+    int removed = 0;
+    int lowest_removed = -1;
+    for (int r = max(0, row_begin); r < min(rows, row_end); ++r) {
+        if (was_full(r)) {
+            removed++;
+            lowest_removed = r;
+        }
+    }
+    if (removed == 0) {
+        return;
+    }
+
+    scratch.assign(row_counts.begin(), row_counts.begin() + lowest_removed + 1);
+    int write = lowest_removed;
+    for (int read = lowest_removed; read >= 0; --read) {
+        if (!was_full(read)) {
+            row_counts[write--] = scratch[read];
+        }
+    }
+    for (; write >= 0; --write) {
+        row_counts[write] = top_full ? 0 : scratch[0];
+    }
+
+    // Each column lost one cell per removed row and, if row 0 was copied into the freed rows,
+    // gained one per copy where row 0 is filled. Tops only move down, so each new top is found
+    // by walking down from the old one.
+    for (int c = 0; c < cols; ++c) {
+        int count = filled[c] - removed;
+        if (!top_full && grid.get(0, c) != 0) {
+            count += removed;
+        }
+        set_filled(c, count);
+
+        int r = rows - heights[c];
+        while (r < rows && grid.get(r, c) == 0) {
+            r++;
+        }
+        set_height(c, rows - r);
+    }
+}
+
+void BoardFeatures::before_compact(const Grid &grid, int col_begin, int col_end) {
+    if (col_begin == 0 && col_end == cols) {
+        return; // after_compact rebuilds every row count from the column counts
+    }
+    // Take the cells of the compacted columns out of the row counts; they come back settled
+    for (int c = col_begin; c < col_end; ++c) {
+        for (int r = rows - heights[c]; r < rows; ++r) {
+            if (grid.get(r, c) != 0) {
+                row_counts[r]--;
+            }
+        }
+    }
+}
+
+void BoardFeatures::after_compact(int col_begin, int col_end) {
+    // Settled columns are solid: no holes, height equal to the cell count
+    for (int c = col_begin; c < col_end; ++c) {
+        set_height(c, filled[c]);
+    }
+    if (col_begin == 0 && col_end == cols) {
+        // Row r holds a cell in every column at least rows - r high
+        scratch.assign(rows + 1, 0);
+        for (int c = 0; c < cols; ++c) {
+            scratch[heights[c]]++;
+        }
+        int at_least = 0;
+        for (int h = rows; h >= 1; --h) {
+            at_least += scratch[h];
+            row_counts[rows - h] = at_least;
+        }
+        return;
+    }
+    for (int c = col_begin; c < col_end; ++c) {
+        for (int r = rows - heights[c]; r < rows; ++r) {
+            row_counts[r]++;
+        }
+    }
+}
+
+void BoardFeatures::cleared() {
+    fill(heights.begin(), heights.end(), 0);
+    fill(filled.begin(), filled.end(), 0);
+    fill(wells.begin(), wells.end(), 0);
+    fill(row_counts.begin(), row_counts.end(), 0);
+    height_sum = filled_sum = bumpiness_sum = well_total = 0;
+    // Empty columns between the walls are wells as deep as the grid
+    for (int c = 0; c < cols; ++c) {
+        update_well(c);
+    }
+}
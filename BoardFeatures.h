@@ -0,0 +1,85 @@
+#ifndef PA2_BOARDFEATURES_H
+#define PA2_BOARDFEATURES_H
+
+#include <vector>
+#include "Grid.h"
+
+using namespace std;
+
+// Board features used to evaluate positions, kept up to date as the grid changes instead of
+// being recomputed by scanning it. Every query is O(1).
+//
+// Heights count from the bottom: a column whose topmost filled cell is in row r has height
+// rows - r. A hole is an empty cell below the top of its column. The well depth of a column is
+// how far it sits below the lower of its two neighbours (the side walls count as full height).
+class BoardFeatures {
+public:
+    void reset(const Grid &grid); // Full recompute, O(filled rows x cols)
+
+    int column_height(int c) const {
+        return heights[c];
+    }
+
+    int column_holes(int c) const {
+        return heights[c] - filled[c];
+    }
+
+    int row_fill(int r) const {
+        return row_counts[r];
+    }
+
+    int well_depth(int c) const {
+        return wells[c];
+    }
+
+    long aggregate_height() const {
+        return height_sum;
+    }
+
+    long holes() const {
+        return height_sum - filled_sum;
+    }
+
+    long bumpiness() const {
+        return bumpiness_sum;
+    }
+
+    long well_sum() const {
+        return well_total;
+    }
+
+    // Updates, called by GameController right where the grid changes
+
+    void cell_filled(int r, int c); // An empty cell became filled
+
+    // After GridKernels::remove_completed_rows removed the full rows of [row_begin, row_end).
+    // The row fill counts still describe the grid before the removal, which is how the removed
+    // rows are found.
+    void rows_removed(const Grid &grid, int row_begin, int row_end);
+
+    // Around GridKernels::compact_columns over [col_begin, col_end)
+    void before_compact(const Grid &grid, int col_begin, int col_end);
+    void after_compact(int col_begin, int col_end);
+
+    void cleared(); // Every cell was cleared
+
+private:
+    int rows = 0;
+    int cols = 0;
+    vector<int> heights;
+    vector<int> filled;     // Filled cells per column
+    vector<int> wells;
+    vector<int> row_counts; // Filled cells per row
+    vector<int> scratch;    // Row remapping in rows_removed
+    long height_sum = 0;
+    long filled_sum = 0;
+    long bumpiness_sum = 0;
+    long well_total = 0;
+
+    void set_height(int c, int height);
+    void set_filled(int c, int count);
+    void update_well(int c);
+    int neighbour_height(int c) const; // Height of column c, or the wall height outside the grid
+};
+
+#endif //PA2_BOARDFEATURES_H
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include "DifferentialHarness.h"
+#include "GameSetup.h"
+
+bool FuzzCase::write(const string &grid_file_name, const string &blocks_file_name, const string &commands_file_name) const {
+    ofstream grid_file(grid_file_name);
+    ofstream blocks_file(blocks_file_name);
+    ofstream commands_file(commands_file_name);
+    if (!grid_file.is_open() || !blocks_file.is_open() || !commands_file.is_open()) {
+        return false;
+    }
+
+    for (const vector<int> &row: grid) {
+        for (size_t j = 0; j < row.size(); ++j) {
+            grid_file << (j == 0 ? "" : " ") << row[j];
+        }
+        grid_file << endl;
+    }
+
+    // One block per bracketed group
+    for (const vector<vector<bool>> &shape: shapes) {
+        for (size_t i = 0; i < shape.size(); ++i) {
+            blocks_file << (i == 0 ? "[" : "");
+            for (size_t j = 0; j < shape[i].size(); ++j) {
+                blocks_file << (j == 0 ? "" : " ") << shape[i][j];
+            }
+            blocks_file << (i + 1 == shape.size() ? "]" : "") << endl;
+        }
+        blocks_file << endl;
+    }
+
+    for (GameCommand command: commands) {
+        commands_file << GameController::command_name(command) << endl;
+    }
+    return true;
+}
+
+DifferentialHarness::DifferentialHarness(FuzzLimits limits) : limits(limits) {
+    default_isa = GridKernels::active_isa();
+
+    // set_isa clamps to what the CPU supports, so a level that does not stick is not available
+    GridKernels::Isa best = GridKernels::ISA_SCALAR;
+    for (GridKernels::Isa isa: {GridKernels::ISA_SCALAR, GridKernels::ISA_SSE2, GridKernels::ISA_AVX2}) {
+        GridKernels::set_isa(isa);
+        if (GridKernels::active_isa() == isa) {
+            engines.push_back({GridKernels::isa_name(isa), isa, 1});
+            best = isa;
+        }
+    }
+    GridKernels::set_isa(default_isa);
+
+    int threads = max(2, (int) thread::hardware_concurrency());
+    engines.push_back({string(GridKernels::isa_name(best)) + " x" + to_string(threads), best, threads});
+}
+
+// Uniform in [low, high], the same on every standard library (unlike uniform_int_distribution)
+static int draw(mt19937_64 &rng, int low, int high) {
+    return low + (int) (rng() % (uint64_t) (high - low + 1));
+}
+
+static vector<vector<bool>> random_shape(mt19937_64 &rng, int max_side) {
+    int height = draw(rng, 1, max_side);
+    int width = draw(rng, 1, max_side);
+    vector<vector<bool>> shape(height, vector<bool>(width, false));
+    for (vector<bool> &row: shape) {
+        for (int j = 0; j < width; ++j) {
+            row[j] = draw(rng, 0, 99) < 60;
+        }
+    }
+    shape[draw(rng, 0, height - 1)][draw(rng, 0, width - 1)] = true;
+    return shape;
+}
+
+FuzzCase DifferentialHarness::generate(uint64_t seed) const {
+    mt19937_64 rng(seed);
+    FuzzCase fuzz_case;
+    fuzz_case.seed = seed;
+
+    // Widths the kernels special-case (fixed-width rows, one word, one cache line and just past it)
+    static const int special_widths[] = {8, 10, 12, 16, 63, 64, 65};
+    int small_rows = max(4, min(limits.small_rows, limits.max_rows));
+    int small_cols = max(4, min(limits.small_cols, limits.max_cols));
+    int rows = draw(rng, 4, small_rows);
+    int cols = draw(rng, 4, small_cols);
+    int size_class = draw(rng, 0, 3);
+    if (size_class == 2 && limits.max_rows > small_rows) {
+        rows = draw(rng, min(limits.max_rows, max(small_rows + 1, GRID_TILE_ROWS + 1)), limits.max_rows);
+    } else if (size_class == 3 && limits.max_cols > small_cols) {
+        cols = draw(rng, small_cols + 1, limits.max_cols);
+    } else if (draw(rng, 0, 2) == 0) {
+        cols = min(cols, special_widths[draw(rng, 0, 6)]);
+    }
+
+    // The lower part of the grid starts partly filled, sometimes with complete rows
+    fuzz_case.grid.assign(rows, vector<int>(cols, 0));
+    int filled_rows = draw(rng, 0, rows / 2);
+    for (int i = rows - filled_rows; i < rows; ++i) {
+        int density = draw(rng, 0, 9) == 0 ? 100 : draw(rng, 20, 90);
+        for (int j = 0; j < cols; ++j) {
+            fuzz_case.grid[i][j] = draw(rng, 0, 99) < density;
+        }
+    }
+
+    // Every rotation of every shape has to fit the grid
+    int block_side = min(limits.max_block_side, min(rows, cols));
+    int block_count = draw(rng, 1, max(1, limits.max_blocks));
+    for (int b = 0; b < block_count; ++b) {
+        fuzz_case.shapes.push_back(random_shape(rng, block_side));
+    }
+    fuzz_case.shapes.push_back(random_shape(rng, min(limits.max_power_up_side, block_side)));
+
+    fuzz_case.gravity_mode_on = draw(rng, 0, 3) == 0;
+
+    int command_count = draw(rng, 1, max(1, limits.max_commands));
+    for (int c = 0; c < command_count; ++c) {
+        int pick = draw(rng, 0, 99);
+        GameCommand command;
+        if (pick < 20) {
+            command = CMD_MOVE_LEFT;
+        } else if (pick < 40) {
+            command = CMD_MOVE_RIGHT;
+        } else if (pick < 50) {
+            command = CMD_ROTATE_RIGHT;
+        } else if (pick < 60) {
+            command = CMD_ROTATE_LEFT;
+        } else if (pick < 75) {
+            command = CMD_DROP;
+        } else if (pick < 90) {
+            command = CMD_SOFT_DROP;
+        } else if (pick < 95) {
+            command = CMD_GRAVITY_SWITCH;
+        } else {
+            command = CMD_PRINT_GRID;
+        }
+        fuzz_case.commands.push_back(command);
+    }
+    return fuzz_case;
+}
+
+// 64-bit FNV-1a, fed one value at a time
+static void hash_add(uint64_t &hash, uint64_t value) {
+    for (int b = 0; b < 8; ++b) {
+        hash ^= (value >> (8 * b)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+}
+
+static const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+static void hash_block(uint64_t &hash, const vector<vector<bool>> &shape, int rotation, int x_offset, int y_offset) {
+    hash_add(hash, rotation);
+    hash_add(hash, x_offset);
+    hash_add(hash, y_offset);
+    hash_add(hash, shape.size());
+    hash_add(hash, shape[0].size());
+    for (const vector<bool> &row: shape) {
+        for (bool cell: row) {
+            hash_add(hash, cell);
+        }
+    }
+}
+
+uint64_t DifferentialHarness::state_hash(const ReferenceEngine &engine) {
+    uint64_t hash = HASH_SEED;
+    hash_add(hash, engine.rows);
+    hash_add(hash, engine.cols);
+    for (const vector<int> &row: engine.grid) {
+        for (int cell: row) {
+            hash_add(hash, cell);
+        }
+    }
+    hash_add(hash, engine.current_score);
+    hash_add(hash, engine.gravity_mode_on);
+    hash_add(hash, engine.game_over);
+    hash_add(hash, engine.has_block());
+    if (engine.has_block()) {
+        hash_block(hash, engine.shape(), engine.rotation, engine.x_offset, engine.y_offset);
+    }
+    return hash;
+}
+
+uint64_t DifferentialHarness::state_hash(const BlockFall &game) {
+    uint64_t hash = HASH_SEED;
+    hash_add(hash, game.rows);
+    hash_add(hash, game.cols);
+    for (int i = 0; i < game.rows; ++i) {
+        for (int j = 0; j < game.cols; ++j) {
+            hash_add(hash, game.grid.get(i, j));
+        }
+    }
+    hash_add(hash, game.current_score);
+    hash_add(hash, game.gravity_mode_on);
+    hash_add(hash, game.game_over);
+    hash_add(hash, game.active_rotation != nullptr);
+    if (game.active_rotation != nullptr) {
+        hash_block(hash, game.active_rotation->shape, game.active_rotation_index, game.x_offset, game.y_offset);
+    }
+    return hash;
+}
+
+void DifferentialHarness::select(const HarnessEngine &engine) const {
+    GridKernels::set_isa(engine.isa);
+    GridKernels::set_parallel(engine.threads, 0);
+}
+
+long DifferentialHarness::first_divergence(const FuzzCase &fuzz_case, uint64_t &reference_hash,
+                                           uint64_t &engine_hash) const {
+    ReferenceEngine reference(fuzz_case.grid, fuzz_case.shapes, fuzz_case.gravity_mode_on);
+    BlockFall game(GameSetup::create(fuzz_case.grid, fuzz_case.shapes), fuzz_case.gravity_mode_on, "", "fuzz");
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+
+    // Same stopping rules as GameController::play. Equal hashes mean both games ended together.
+    for (size_t step = 0;; ++step) {
+        reference_hash = state_hash(reference);
+        engine_hash = state_hash(game);
+        if (reference_hash != engine_hash) {
+            return step;
+        }
+        if (step == fuzz_case.commands.size() || reference.game_over || !reference.has_block()) {
+            return -1;
+        }
+        reference.apply(fuzz_case.commands[step]);
+        controller.apply_command(game, fuzz_case.commands[step]);
+    }
+}
+
+static int largest_side(const FuzzCase &fuzz_case) {
+    int side = 1;
+    for (const vector<vector<bool>> &shape: fuzz_case.shapes) {
+        side = max(side, (int) max(shape.size(), shape[0].size()));
+    }
+    return side;
+}
+
+FuzzCase DifferentialHarness::minimize(const FuzzCase &fuzz_case) const {
+    uint64_t reference_hash;
+    uint64_t engine_hash;
+    auto diverges = [&](const FuzzCase &candidate) {
+        return first_divergence(candidate, reference_hash, engine_hash) >= 0;
+    };
+    auto truncate = [&](FuzzCase &candidate) {
+        candidate.commands.resize(first_divergence(candidate, reference_hash, engine_hash));
+    };
+
+    // Nothing after the divergence matters
+    FuzzCase best = fuzz_case;
+    truncate(best);
+
+    // Commands: remove ever smaller runs of commands while the case still diverges
+    for (size_t chunk = max<size_t>(1, best.commands.size() / 2);; chunk /= 2) {
+        for (size_t begin = 0; begin < best.commands.size();) {
+            FuzzCase candidate = best;
+            candidate.commands.erase(candidate.commands.begin() + begin,
+                                     candidate.commands.begin() + min(begin + chunk, candidate.commands.size()));
+            if (diverges(candidate)) {
+                best = candidate;
+            } else {
+                begin += chunk;
+            }
+        }
+        if (chunk == 1) {
+            break;
+        }
+    }
+
+    // Blocks: keep at least one block besides the power-up
+    for (size_t b = 0; b + 1 < best.shapes.size() && best.shapes.size() > 2;) {
+        FuzzCase candidate = best;
+        candidate.shapes.erase(candidate.shapes.begin() + b);
+        if (diverges(candidate)) {
+            best = candidate;
+        } else {
+            ++b;
+        }
+    }
+
+    // Grid: drop top rows and right columns while every shape still fits, then empty whole rows
+    int side = largest_side(best);
+    while ((int) best.grid.size() > side) {
+        FuzzCase candidate = best;
+        candidate.grid.erase(candidate.grid.begin());
+        if (!diverges(candidate)) {
+            break;
+        }
+        best = candidate;
+    }
+    while ((int) best.grid[0].size() > side) {
+        FuzzCase candidate = best;
+        for (vector<int> &row: candidate.grid) {
+            row.pop_back();
+        }
+        if (!diverges(candidate)) {
+            break;
+        }
+        best = candidate;
+    }
+    for (size_t i = 0; i < best.grid.size(); ++i) {
+        if (count(best.grid[i].begin(), best.grid[i].end(), 0) == (long) best.grid[i].size()) {
+            continue;
+        }
+        FuzzCase candidate = best;
+        fill(candidate.grid[i].begin(), candidate.grid[i].end(), 0);
+        if (diverges(candidate)) {
+            best = candidate;
+        }
+    }
+
+    truncate(best);
+    return best;
+}
+
+bool DifferentialHarness::check(uint64_t first_seed, int case_count, const string &reproducer_prefix, ostream &out) {
+    divergences.clear();
+    out << "Differential check: " << case_count << " cases from seed " << first_seed << ", "
+        << GRID_CELL_BITS << "-bit cells" << endl;
+
+    for (const HarnessEngine &engine: engines) {
+        select(engine);
+        bool diverged = false;
+        for (int c = 0; c < case_count && !diverged; ++c) {
+            FuzzCase fuzz_case = generate(first_seed + c);
+            Divergence divergence;
+            divergence.step = first_divergence(fuzz_case, divergence.reference_hash, divergence.engine_hash);
+            if (divergence.step < 0) {
+                continue;
+            }
+
+            diverged = true;
+            divergence.engine = engine.name;
+            divergence.seed = fuzz_case.seed;
+            divergence.reproducer = minimize(fuzz_case);
+            uint64_t reference_hash;
+            uint64_t engine_hash;
+            divergence.reproducer_step = first_divergence(divergence.reproducer, reference_hash, engine_hash);
+
+            out << left << setw(12) << engine.name << right << " DIVERGED on seed " << divergence.seed;
+            if (divergence.step == 0) {
+                out << " in the initial state";
+            } else {
+                out << " after command " << divergence.step << " ("
+                    << GameController::command_name(fuzz_case.commands[divergence.step - 1]) << ")";
+            }
+            out << hex << ": reference " << divergence.reference_hash << ", engine " << divergence.engine_hash << dec << endl;
+
+            const FuzzCase &reproducer = divergence.reproducer;
+            out << setw(12) << "" << " reproducer: " << reproducer.grid.size() << "x" << reproducer.grid[0].size()
+                << " grid, " << reproducer.shapes.size() - 1 << " block(s), " << reproducer.commands.size()
+                << " command(s), gravity " << (reproducer.gravity_mode_on ? "on" : "off") << endl;
+            if (!reproducer_prefix.empty()) {
+                string prefix = reproducer_prefix + engine.name;
+                replace(prefix.begin(), prefix.end(), ' ', '_');
+                if (reproducer.write(prefix + "_grid.txt", prefix + "_blocks.txt", prefix + "_commands.txt")) {
+                    out << setw(12) << "" << " written to " << prefix << "_{grid,blocks,commands}.txt" << endl;
+                }
+            }
+            divergences.push_back(divergence);
+        }
+        if (!diverged) {
+            out << left << setw(12) << engine.name << right << " ok on every case" << endl;
+        }
+    }
+
+    select({"", default_isa, 1});
+    return divergences.empty();
+}
+
+void DifferentialHarness::benchmark(uint64_t first_seed, int case_count, ostream &out) {
+    typedef chrono::steady_clock clock;
+    timings.assign(engines.size() + 1, EngineTiming());
+    timings[0].name = "reference";
+    for (size_t e = 0; e < engines.size(); ++e) {
+        timings[e + 1].name = engines[e].name;
+    }
+
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+    long commands = 0;
+
+    // One engine at a time over every case, so each keeps its kernel settings (and pool) throughout
+    for (size_t t = 0; t < timings.size(); ++t) {
+        if (t > 0) {
+            select(engines[t - 1]);
+        }
+        for (int c = 0; c < case_count; ++c) {
+            FuzzCase fuzz_case = generate(first_seed + c);
+            if (t == 0) {
+                commands += fuzz_case.commands.size();
+                clock::time_point start = clock::now();
+                ReferenceEngine reference(fuzz_case.grid, fuzz_case.shapes, fuzz_case.gravity_mode_on);
+                for (size_t i = 0; i < fuzz_case.commands.size() && !reference.game_over && reference.has_block(); ++i) {
+                    reference.apply(fuzz_case.commands[i]);
+                }
+                timings[t].seconds += chrono::duration<double>(clock::now() - start).count();
+                continue;
+            }
+
+            shared_ptr<const GameSetup> setup = GameSetup::create(fuzz_case.grid, fuzz_case.shapes);
+            clock::time_point start = clock::now();
+            BlockFall game(setup, fuzz_case.gravity_mode_on, "", "fuzz");
+            for (size_t i = 0; i < fuzz_case.commands.size() && !game.game_over && game.has_next_block(game); ++i) {
+                controller.apply_command(game, fuzz_case.commands[i]);
+            }
+            timings[t].seconds += chrono::duration<double>(clock::now() - start).count();
+        }
+    }
+    select({"", default_isa, 1});
+
+    out << "Benchmark: " << case_count << " cases, " << commands << " commands" << endl;
+    for (EngineTiming &timing: timings) {
+        timing.speedup = timing.seconds > 0 ? timings[0].seconds / timing.seconds : 0;
+        out << left << setw(12) << timing.name << right << fixed << setprecision(3) << setw(10) << timing.seconds
+            << " s" << setprecision(2) << setw(9) << timing.speedup << "x" << endl;
+    }
+    out << defaultfloat;
+}
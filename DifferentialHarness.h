@@ -0,0 +1,109 @@
+#ifndef PA2_DIFFERENTIALHARNESS_H
+#define PA2_DIFFERENTIALHARNESS_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BlockFall.h"
+#include "GameController.h"
+#include "GridKernels.h"
+#include "ReferenceEngine.h"
+
+using namespace std;
+
+// One generated game: the initial grid, the blocks (the last shape is the power-up), the gravity
+// mode the game starts in and the commands
+struct FuzzCase {
+    uint64_t seed = 0;
+    vector<vector<int>> grid;
+    vector<vector<vector<bool>>> shapes;
+    bool gravity_mode_on = false;
+    vector<GameCommand> commands;
+
+    // Writes the grid, blocks and commands files in the formats the game reads
+    bool write(const string &grid_file_name, const string &blocks_file_name, const string &commands_file_name) const;
+};
+
+// Upper bounds for generated cases. Half the cases stay within small_rows x small_cols, with widths
+// drawn either from the widths the kernels special-case or uniformly. A quarter are taller than
+// small_rows (at least one 64-row tile plus a row when max_rows allows), the other quarter wider
+// than small_cols, so grid tiles and multi-slice parallel passes are both covered.
+struct FuzzLimits {
+    int small_rows = 32;
+    int small_cols = 160;
+    int max_rows = 160;
+    int max_cols = 600; // Past 512 columns even 1-bit cells split into several slices
+    int max_blocks = 16;
+    int max_block_side = 4;
+    int max_power_up_side = 3;
+    int max_commands = 400;
+};
+
+// One optimized configuration of GameController: kernel instruction set and kernel threads
+struct HarnessEngine {
+    string name;
+    GridKernels::Isa isa = GridKernels::ISA_SCALAR;
+    int threads = 1; // GridKernels::set_parallel threads, applied to grids of any size
+};
+
+struct Divergence {
+    string engine;
+    uint64_t seed = 0;
+    long step = 0;              // Commands applied when the states first differed (0 = initial state)
+    uint64_t reference_hash = 0;
+    uint64_t engine_hash = 0;
+    FuzzCase reproducer;        // Smallest case found that still diverges
+    long reproducer_step = 0;   // Step at which the reproducer diverges
+};
+
+struct EngineTiming {
+    string name;
+    double seconds = 0;  // Time to replay every case, setup parsing excluded
+    double speedup = 0;  // Reference time / engine time
+};
+
+// Seeded differential testing of the optimized game against ReferenceEngine. Every generated case
+// is replayed by the reference and by each engine, and the state hashes (grid, score, active block,
+// gravity, game end) are compared after every command. A case is fully determined by its seed and
+// the limits, so a failing seed reproduces on any machine.
+//
+// The kernel settings are process-wide: the harness switches them per engine and leaves the
+// kernels single-threaded on the instruction set that was active when it was created.
+class DifferentialHarness {
+public:
+    explicit DifferentialHarness(FuzzLimits limits = FuzzLimits());
+
+    FuzzLimits limits;
+    vector<HarnessEngine> engines; // By default every supported ISA single-threaded, and the best one multi-threaded
+
+    vector<Divergence> divergences; // First divergence of each engine found by check()
+    vector<EngineTiming> timings;   // Filled by benchmark(), reference first
+
+    FuzzCase generate(uint64_t seed) const;
+
+    // Checks seeds first_seed .. first_seed + case_count - 1 and stops each engine at its first
+    // divergence, which is minimized and written as <reproducer_prefix>{grid,blocks,commands}.txt
+    // (an empty prefix writes nothing). Returns true if every engine matched on every case.
+    bool check(uint64_t first_seed, int case_count, const string &reproducer_prefix, ostream &out);
+
+    // Replays the same cases without hashing and reports each engine's speedup over the reference
+    void benchmark(uint64_t first_seed, int case_count, ostream &out);
+
+    static uint64_t state_hash(const ReferenceEngine &engine);
+
+    static uint64_t state_hash(const BlockFall &game);
+
+private:
+    GridKernels::Isa default_isa;
+
+    void select(const HarnessEngine &engine) const;
+
+    // Commands applied when the selected engine first disagreed with the reference, or -1 if it
+    // never did
+    long first_divergence(const FuzzCase &fuzz_case, uint64_t &reference_hash, uint64_t &engine_hash) const;
+
+    FuzzCase minimize(const FuzzCase &fuzz_case) const; // On the selected engine
+};
+
+#endif //PA2_DIFFERENTIALHARNESS_H
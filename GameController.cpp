@@ -1,7 +1,10 @@
 #include <iostream>
 #include <fstream>
 #include "GameController.h"
+#include "AllocationCounter.h"
 #include "Leaderboard.h"
+#include "GridKernels.h"
+#include "TraceWriter.h"
 
 bool GameController::play(BlockFall& game, const string& commands_file) {
     ifstream file(commands_file);
@@ -10,102 +13,225 @@ bool GameController::play(BlockFall& game, const string& commands_file) {
         return false;
     }
 
+    if (allocation_free) {
+        CommandScript script;
+        read_commands(file, script);
+        file.close();
+        prepare(game);
+        return play(game, script);
+    }
+
     string line;
+    GameEnd end = END_NO_MORE_COMMANDS;
     while (getline(file, line)) {
-        if (line == "PRINT_GRID") {
+        GameCommand command = parse_command(line);
+        if (command == CMD_UNKNOWN) {
+            *output << "Unknown command: " << line << endl;
+        } else {
+            apply_command(game, command);
+        }
+
+        if (game_ended(game, end)) {
+            break;
+        }
+    }
+
+    finish_game(game, end);
+    return end != END_GAME_OVER;
+}
+
+bool GameController::play(BlockFall& game, const CommandScript& script) {
+    unsigned long allocations = AllocationCounter::allocations();
+    size_t unknown = 0;
+    GameEnd end = END_NO_MORE_COMMANDS;
+    for (GameCommand command: script.commands) {
+        if (command == CMD_UNKNOWN) {
+            *output << "Unknown command: " << script.unknown_lines[unknown++] << endl;
+        } else {
+            apply_command(game, command);
+        }
+
+        if (game_ended(game, end)) {
+            break;
+        }
+    }
+    loop_allocations = AllocationCounter::allocations() - allocations;
+
+    finish_game(game, end);
+    return end != END_GAME_OVER;
+}
+
+bool GameController::game_ended(BlockFall& game, GameEnd& end) {
+    // Check if the game is over
+    if (game.game_over) {
+        end = END_GAME_OVER;
+        return true;
+    }
+
+    // Check if no more blocks are available
+    if (!game.has_next_block(game)) {
+        end = END_NO_MORE_BLOCKS;
+        return true;
+    }
+    return false;
+}
+
+void GameController::read_commands(istream& in, CommandScript& script) {
+    string line;
+    while (getline(in, line)) {
+        GameCommand command = parse_command(line);
+        script.commands.push_back(command);
+        if (command == CMD_UNKNOWN) {
+            script.unknown_lines.push_back(line);
+        }
+    }
+}
+
+void GameController::prepare(BlockFall& game, bool allocate_tiles) {
+    if (allocate_tiles) {
+        game.grid.allocate_all();
+    }
+    GridKernels::reserve_scratch(game.grid);
+    row_text.reserve(game.cols * GridKernels::GLYPH_BYTES);
+    game.leaderboard.reserve_entries(1);
+    game.leaderboard.intern(game.player_name);
+}
+
+GameCommand GameController::parse_command(const string& line) {
+    if (line == "PRINT_GRID") {
+        return CMD_PRINT_GRID;
+    } else if (line == "ROTATE_RIGHT") {
+        return CMD_ROTATE_RIGHT;
+    } else if (line == "ROTATE_LEFT") {
+        return CMD_ROTATE_LEFT;
+    } else if (line == "MOVE_RIGHT") {
+        return CMD_MOVE_RIGHT;
+    } else if (line == "MOVE_LEFT") {
+        return CMD_MOVE_LEFT;
+    } else if (line == "DROP") {
+        return CMD_DROP;
+    } else if (line == "GRAVITY_SWITCH") {
+        return CMD_GRAVITY_SWITCH;
+    } else if (line == "SOFT_DROP") {
+        return CMD_SOFT_DROP;
+    }
+    return CMD_UNKNOWN;
+}
+
+const char *GameController::command_name(GameCommand command) {
+    switch (command) {
+        case CMD_PRINT_GRID:
+            return "PRINT_GRID";
+        case CMD_ROTATE_RIGHT:
+            return "ROTATE_RIGHT";
+        case CMD_ROTATE_LEFT:
+            return "ROTATE_LEFT";
+        case CMD_MOVE_RIGHT:
+            return "MOVE_RIGHT";
+        case CMD_MOVE_LEFT:
+            return "MOVE_LEFT";
+        case CMD_DROP:
+            return "DROP";
+        case CMD_GRAVITY_SWITCH:
+            return "GRAVITY_SWITCH";
+        case CMD_SOFT_DROP:
+            return "SOFT_DROP";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+void GameController::apply_command(BlockFall& game, GameCommand command) {
+    if (trace != nullptr && !trace->started) {
+        trace->begin_game(game);
+    }
+    switch (command) {
+        case CMD_PRINT_GRID:
             print_grid(game);
-        } else if (line == "ROTATE_RIGHT") {
+            break;
+        case CMD_ROTATE_RIGHT:
             rotate_right(game);
-        } else if (line == "ROTATE_LEFT") {
+            break;
+        case CMD_ROTATE_LEFT:
             rotate_left(game);
-        } else if (line == "MOVE_RIGHT") {
+            break;
+        case CMD_MOVE_RIGHT:
             move_right(game);
-        } else if (line == "MOVE_LEFT") {
+            break;
+        case CMD_MOVE_LEFT:
             move_left(game);
-        } else if (line == "DROP") {
+            break;
+        case CMD_DROP:
             drop_block(game);
-        } else if (line == "GRAVITY_SWITCH") {
-            if (game.gravity_mode_on){
-                game.gravity_mode_on = false;
-                toggle_gravity(game);
-            } else {
-                game.gravity_mode_on = true;
-                toggle_gravity(game);
+            break;
+        case CMD_SOFT_DROP:
+            soft_drop(game);
+            break;
+        case CMD_GRAVITY_SWITCH:
+            // Nothing is known about the grid under the new mode, so the next passes scan it all
+            game.mark_all_dirty();
+            game.gravity_mode_on = !game.gravity_mode_on;
+            if (trace != nullptr) {
+                trace->gravity_mode(game.gravity_mode_on);
             }
-        } else {
-            cout << "Unknown command: " << line << endl;
-        }
-
-        // Check if the game is over
-        if (game.game_over) {
-            // Get current time
-            time_t currentTime = time(nullptr);
-
-            // Create a new leaderboard entry
-            LeaderboardEntry* newEntry = new LeaderboardEntry(game.current_score, currentTime, game.player_name);
-
-            // Insert the new entry to the leaderboard
-            game.leaderboard.insert_new_entry(newEntry);
-            cout << "GAME OVER!" << endl;
-            cout << "Next block that couldn't fit:" << endl;
-            print_2d_vectorBool(game.active_rotation->shape);
-            cout << endl;
-            cout << "Final grid and score:" << endl;
-            cout << endl;
-            cout << "Score: " << game.current_score << endl;
-            cout << "High Score: " << game.leaderboard.head_leaderboard_entry->score << endl;
-            print_2d_vector(game.grid);
-            cout << endl;
-            game.leaderboard.print_leaderboard();
-            game.leaderboard.write_to_file(game.leaderboard_file_name);
-            return false;
-        }
-
-        // Check if no more blocks are available
-        if (!game.has_next_block(game)) {
-
-            // Get current time
-            time_t currentTime = time(nullptr);
-
-            // Create a new leaderboard entry
-            LeaderboardEntry* newEntry = new LeaderboardEntry(game.current_score, currentTime, game.player_name); // Replace "Player" with the actual player name
-
-            // Insert the new entry to the leaderboard
-            game.leaderboard.insert_new_entry(newEntry);
-            cout << "YOU WIN!" << endl;
-            cout << "No more blocks." << endl;
-            cout << "Final grid and score:" << endl;
-            cout << endl;
-            cout << "Score: " << game.current_score << endl;
-            cout << "High Score: " << game.leaderboard.head_leaderboard_entry->score << endl;
-            print_2d_vector(game.grid);
-            cout << endl;
-            game.leaderboard.print_leaderboard();
-            game.leaderboard.write_to_file(game.leaderboard_file_name);
-            return true;
-        }
+            toggle_gravity(game);
+            break;
+        default:
+            break;
+    }
+    if (trace != nullptr) {
+        trace->end_command(game);
     }
+}
 
-//  If the file is exhausted
+void GameController::finish_game(BlockFall& game, GameEnd end) {
     // Get current time
     time_t currentTime = time(nullptr);
 
-    // Create a new leaderboard entry
-    LeaderboardEntry* newEntry = new LeaderboardEntry(game.current_score, currentTime, game.player_name); // Replace "Player" with the actual player name
-
-    // Insert the new entry to the leaderboard
+    // Create a new leaderboard entry and insert it to the leaderboard
+    LeaderboardEntry* newEntry = game.leaderboard.create_entry(game.current_score, currentTime, game.player_name);
     game.leaderboard.insert_new_entry(newEntry);
-    cout << "GAME FINISHED!" << endl;
-    cout << "No more commands." << endl;
-    cout << "Final grid and score:" << endl;
-    cout << endl;
-    cout << "Score: " << game.current_score << endl;
-    cout << "High Score: " << game.leaderboard.head_leaderboard_entry->score << endl;
-    print_2d_vector(game.grid);
-    cout << endl;
-    game.leaderboard.write_to_file(game.leaderboard_file_name);
-    game.leaderboard.print_leaderboard();
-    return true;
+
+    if (end == END_GAME_OVER) {
+        *output << "GAME OVER!" << endl;
+        *output << "Next block that couldn't fit:" << endl;
+        print_2d_vectorBool(game.active_rotation->shape);
+        *output << endl;
+    } else if (end == END_NO_MORE_BLOCKS) {
+        *output << "YOU WIN!" << endl;
+        *output << "No more blocks." << endl;
+    } else {
+        *output << "GAME FINISHED!" << endl;
+        *output << "No more commands." << endl;
+    }
+    *output << "Final grid and score:" << endl;
+    *output << endl;
+    *output << "Score: " << game.current_score << endl;
+    *output << "High Score: " << game.leaderboard.head_leaderboard_entry->score << endl;
+    if (trace != nullptr) {
+        // A game can end before its first command (an empty commands file)
+        if (!trace->started) {
+            trace->begin_game(game);
+        }
+        trace->end_command(game);
+        trace->game_end(game, end);
+    } else {
+        print_2d_vector(game.grid);
+    }
+    *output << endl;
+    // Games without a leaderboard file (hosted sessions) only keep the entry in memory
+    bool save = !game.leaderboard_file_name.empty();
+    if (end == END_NO_MORE_COMMANDS) {
+        if (save) {
+            game.leaderboard.write_to_file(game.leaderboard_file_name);
+        }
+        game.leaderboard.print_leaderboard(*output);
+    } else {
+        game.leaderboard.print_leaderboard(*output);
+        if (save) {
+            game.leaderboard.write_to_file(game.leaderboard_file_name);
+        }
+    }
 }
 
 bool GameController::is_collision(BlockFall& game, int x_offset, int y_offset) {
@@ -244,6 +370,10 @@ void GameController::drop_block(BlockFall& game) {
 
     game.current_score += game.y_offset * numberof1;
 
+    if (trace != nullptr) {
+        trace->placement(game);
+    }
+
     // Update the grid with the settled block
     update_grid(game);
 
@@ -256,10 +386,7 @@ void GameController::drop_block(BlockFall& game) {
 
         if (completed_rows > 0) {
             // Remove completed rows and update the grid
-            std::cout << "Before clearing:" << std::endl;
-            print_2d_vector(game.grid);
-            std::cout << std::endl;
-            std::cout << std::endl;
+            report_clear(game, false);
             remove_completed_rows(game);
         }
     }
@@ -280,6 +407,15 @@ void GameController::drop_block(BlockFall& game) {
     }
 }
 
+void GameController::soft_drop(BlockFall& game) {
+    // Move the block one row down, or settle it where it is if it cannot move any further
+    if (!is_collision(game, 0, 1) && is_valid_position(game, 0, 1)) {
+        game.y_offset++;
+    } else {
+        drop_block(game);
+    }
+}
+
 void GameController::update_grid(BlockFall& game) {
     Block* active_block = game.active_rotation;
 
@@ -288,32 +424,26 @@ void GameController::update_grid(BlockFall& game) {
         for (int j = 0; j < active_block->shape[0].size(); ++j) {
             if (active_block->shape[i][j] == 1) {
                 // Update the corresponding cell in the grid with the block's value
-                game.grid[game.y_offset + i][game.x_offset + j] = 1;
+                if (game.grid.get(game.y_offset + i, game.x_offset + j) == 0) {
+                    game.features.cell_filled(game.y_offset + i, game.x_offset + j);
+                }
+                game.grid.set(game.y_offset + i, game.x_offset + j, 1);
             }
         }
     }
+    game.mark_dirty(game.y_offset, game.y_offset + active_block->shape.size(),
+                    game.x_offset, game.x_offset + active_block->shape[0].size());
 
     toggle_gravity(game);
 }
 
 int GameController::check_completed_rows(BlockFall& game) {
-    int completed_rows = 0;
-
-    // Iterate over each row in the grid
-    for (int i = 0; i < game.rows; ++i) {
-        // Check if the current row is full
-        bool is_row_full = true;
-        for (int j = 0; j < game.cols; ++j) {
-            if (game.grid[i][j] == 0) {
-                is_row_full = false;
-                break;
-            }
-        }
-
-        // If the row is full, increment the completed_rows count
-        if (is_row_full) {
-            completed_rows++;
-        }
+    // Count the full rows (fixed-width or vector kernels, see GridKernels). Only rows changed
+    // since the last check can have become full.
+    int completed_rows = GridKernels::count_completed_rows(game.grid, game.dirty_rows.row_begin,
+                                                           game.dirty_rows.row_end);
+    if (completed_rows == 0) {
+        game.dirty_rows.clear();
     }
 
     game.current_score += completed_rows * game.cols;
@@ -322,31 +452,25 @@ int GameController::check_completed_rows(BlockFall& game) {
 }
 
 void GameController::remove_completed_rows(BlockFall& game) {
-    // Iterate over each row in the grid
-    for (int i = 0; i < game.rows; ++i) {
-        // Check if the current row is full
-        bool is_row_full = true;
-        for (int j = 0; j < game.cols; ++j) {
-            if (game.grid[i][j] == 0) {
-                is_row_full = false;
-                break;
-            }
-        }
-
-        // If the row is full, remove it by shifting the rows above it down
-        if (is_row_full) {
-            // Clear the current row
-            for (int j = 0; j < game.cols; ++j) {
-                game.grid[i][j] = 0;
-            }
+    // Pack the remaining rows to the bottom of the grid
+    bool refills_from_top = game.grid.row_occupied(0);
+    int lowest_removed = GridKernels::remove_completed_rows(game.grid, game.dirty_rows.row_begin,
+                                                            game.dirty_rows.row_end);
+    if (lowest_removed >= 0) {
+        game.features.rows_removed(game.grid, game.dirty_rows.row_begin, game.dirty_rows.row_end);
+    }
+    game.dirty_rows.clear();
+    if (lowest_removed < 0) {
+        return;
+    }
 
-            // Shift the rows above it down
-            for (int k = i; k > 0; --k) {
-                for (int j = 0; j < game.cols; ++j) {
-                    game.grid[k][j] = game.grid[k - 1][j];
-                }
-            }
-        }
+    // Everything above the lowest removed row has moved. Settled columns stay settled when a full
+    // row is removed, unless the freed rows on top are refilled from a non-empty row 0.
+    game.dirty_power_up.add(0, lowest_removed + 1, 0, game.cols);
+    game.dirty_trace.add(0, lowest_removed + 1, 0, game.cols);
+    game.dirty_screen.add(0, lowest_removed + 1, 0, game.cols);
+    if (refills_from_top || !game.dirty_gravity.empty()) {
+        game.dirty_gravity.add(0, lowest_removed + 1, 0, game.cols);
     }
 }
 
@@ -355,36 +479,67 @@ void GameController::check_power_ups(BlockFall& game) {
 
     bool foundPowerUp;
 
-    foundPowerUp = findMatrix(game.grid, game.power_up);
+    // Only windows overlapping a changed cell can have started to match
+    foundPowerUp = findMatrix(game.grid, game.power_up, game.dirty_power_up);
+    game.dirty_power_up.clear();
 
     // If the power-up shape is found, clear the corresponding portion of the grid
     int numberOfOne = 0;
     if (foundPowerUp) {
-        std::cout << "Before clearing:" << std::endl;
-        print_2d_vector(game.grid);
-        std::cout << std::endl;
-        std::cout << std::endl;
-        for (int i = 0; i < game.rows; ++i) {
-            for (int j = 0; j < game.cols; ++j) {
-                if (game.grid[i][j] == 1){
-                    game.grid[i][j] = 0;
-                    numberOfOne++;
-                }
-            }
+        report_clear(game, true);
+        numberOfOne = GridKernels::count_and_clear_ones(game.grid);
+        game.features.cleared();
+        if (trace != nullptr) {
+            trace->power_up(numberOfOne);
         }
         game.current_score += 1000;
         game.current_score += numberOfOne;
+        game.mark_all_dirty();
     }
 
 }
 
-bool GameController::findMatrix(const std::vector<std::vector<int>>& source, const std::vector<std::vector<bool>>& target) {
-    for (size_t i = 0; i <= source.size() - target.size(); ++i) {
-        for (size_t j = 0; j <= source[i].size() - target[0].size(); ++j) {
+bool GameController::findMatrix(const Grid& source, const std::vector<std::vector<bool>>& target) {
+    DirtyRegion whole;
+    whole.add(0, source.rows, 0, source.cols);
+    return findMatrix(source, target, whole);
+}
+
+bool GameController::findMatrix(const Grid& source, const std::vector<std::vector<bool>>& target,
+                                const DirtyRegion& region) {
+    // A window can only match if the grid row under the first filled target row holds cells,
+    // so windows over empty rows (and empty tiles) are skipped without looking at the cells
+    int anchor = -1;
+    for (size_t k = 0; k < target.size() && anchor < 0; ++k) {
+        for (size_t l = 0; l < target[k].size(); ++l) {
+            if (target[k][l]) {
+                anchor = k;
+                break;
+            }
+        }
+    }
+
+    if (region.empty()) {
+        return false;
+    }
+
+    // Windows that overlap the region
+    int height = target.size();
+    int width = target[0].size();
+    int first_row = max(0, region.row_begin - height + 1);
+    int last_row = min(source.rows - height, region.row_end - 1);
+    int first_col = max(0, region.col_begin - width + 1);
+    int last_col = min(source.cols - width, region.col_end - 1);
+
+    for (int i = first_row; i <= last_row; ++i) {
+        if (anchor >= 0 && !source.row_occupied(i + anchor)) {
+            continue;
+        }
+        for (int j = first_col; j <= last_col; ++j) {
             bool found = true;
             for (size_t k = 0; k < target.size(); ++k) {
                 for (size_t l = 0; l < target[k].size(); ++l) {
-                    if (source[i + k][j + l] != target[k][l]) {
+                    if (source.get(i + k, j + l) != target[k][l]) {
                         found = false;
                         break;
                     }
@@ -404,21 +559,18 @@ bool GameController::findMatrix(const std::vector<std::vector<int>>& source, con
 void GameController::toggle_gravity(BlockFall& game) {
 
     // If the gravity mode is GRAVITY_ON, update the block's fall behavior
-    if (game.gravity_mode_on) {
-        // Implement gravity mode behavior
-
-        int number = 0;
-        while(number < game.rows){
-            for (int i = 0; i < game.rows; ++i) {
-                for (int j = 0; j < game.cols; ++j) {
-                    if (i != game.rows -1 && game.grid[i][j] == 1 && game.grid[i + 1][j] == 0){
-                        game.grid[i][j] = 0;
-                        game.grid[i + 1][j] = 1;
-                    }
-                }
-            }
-            number++;
+    if (game.gravity_mode_on && !game.dirty_gravity.empty()) {
+        // Every filled cell falls to the bottom of its column. Only the dirty columns can hold
+        // unsettled cells, and nothing moves above the top of the dirty region.
+        DirtyRegion settled = game.dirty_gravity;
+        game.features.before_compact(game.grid, settled.col_begin, settled.col_end);
+        GridKernels::compact_columns(game.grid, settled.col_begin, settled.col_end);
+        game.features.after_compact(settled.col_begin, settled.col_end);
+        if (trace != nullptr) {
+            trace->gravity(settled.col_begin, settled.col_end);
         }
+        game.mark_dirty(settled.row_begin, game.rows, settled.col_begin, settled.col_end);
+        game.dirty_gravity.clear();
     }
 
     // Check for completed rows, remove them, and update the score
@@ -426,56 +578,73 @@ void GameController::toggle_gravity(BlockFall& game) {
 
     if (completed_rows > 0) {
         // Remove completed rows and update the grid
-        std::cout << "Before clearing:" << std::endl;
-        print_2d_vector(game.grid);
-        std::cout << std::endl;
-        std::cout << std::endl;
+        report_clear(game, false);
         remove_completed_rows(game);
     }
 }
 
 void GameController::print_grid(BlockFall& game) {
     // Print player's current score
-    std::cout << "Score: " << game.current_score << std::endl;
+    *output << "Score: " << game.current_score << endl;
 
-    // Print all-time high score
-    std::cout << "High Score: " << game.leaderboard.head_leaderboard_entry->score << std::endl;
+    // Print all-time high score (games without a leaderboard file start with an empty one)
+    LeaderboardEntry* best = game.leaderboard.head_leaderboard_entry;
+    *output << "High Score: " << (best != nullptr ? best->score : 0) << endl;
 
-    // Print the grid
+    // Print the grid one row at a time, with the active block drawn over the settled cells
     for (int i = 0; i < game.rows; ++i) {
-        for (int j = 0; j < game.cols; ++j) {
-            // Check if the current cell belongs to the active block
-            if (i >= game.y_offset && i < game.y_offset + game.active_rotation->shape.size() &&
-                j >= game.x_offset && j < game.x_offset + game.active_rotation->shape[0].size() &&
-                game.active_rotation->shape[i - game.y_offset][j - game.x_offset] == 1) {
-                std::cout << occupiedCellChar; // Print black cell for active block
-            } else {
-                // Print white cell for empty cell, black cell for filled cell
-                std::cout << (game.grid[i][j] == 0 ? unoccupiedCellChar : occupiedCellChar);
-            }
+        render_row(game, i, row_text);
+        *output << row_text << endl;
+    }
+
+    *output << endl;
+    *output << endl;
+}
+
+void GameController::render_row(const BlockFall& game, int i, string& line) const {
+    line.resize(game.cols * GridKernels::GLYPH_BYTES);
+    GridKernels::expand_row(game.grid, i, &line[0]);
+
+    Block* active_block = game.active_rotation;
+    if (active_block == nullptr || i < game.y_offset || i >= game.y_offset + (int) active_block->shape.size()) {
+        return;
+    }
+    const vector<bool>& shape_row = active_block->shape[i - game.y_offset];
+    for (int j = 0; j < (int) shape_row.size(); ++j) {
+        if (shape_row[j] && game.x_offset + j < game.cols) {
+            line.replace((game.x_offset + j) * GridKernels::GLYPH_BYTES, GridKernels::GLYPH_BYTES, occupiedCellChar);
         }
-        std::cout << std::endl;
     }
+}
 
-    std::cout << std::endl;
-    std::cout << std::endl;
+void GameController::print_2d_vector(const Grid& grid) const {
+    row_text.resize(grid.cols * GridKernels::GLYPH_BYTES);
+    for (int i = 0; i < grid.rows; ++i) {
+        GridKernels::expand_row(grid, i, &row_text[0]);
+        *output << row_text << endl;
+    }
 }
 
-void GameController::print_2d_vector(const vector<vector<int>>& vec) const {
-    for (const auto &row: vec) {
-        for (const auto &element: row) {
-            cout << (element == 0 ? unoccupiedCellChar : occupiedCellChar) ;
+void GameController::report_clear(BlockFall& game, bool power_up) {
+    if (trace != nullptr) {
+        // The power-up record follows once the cleared cells are counted
+        if (!power_up) {
+            trace->rows_cleared(game);
         }
-        cout << endl;
+        return;
     }
+    *output << "Before clearing:" << endl;
+    print_2d_vector(game.grid);
+    *output << endl;
+    *output << endl;
 }
 
 void GameController::print_2d_vectorBool(const vector<vector<bool>>& vec) const {
     for (const auto &row: vec) {
         for (const auto &element: row) {
-            cout << (element == 0 ? unoccupiedCellChar : occupiedCellChar);
+            *output << (element == 0 ? unoccupiedCellChar : occupiedCellChar);
         }
-        cout << endl;
+        *output << endl;
     }
 }
 
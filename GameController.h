@@ -1,14 +1,68 @@
 #ifndef PA2_GAMECONTROLLER_H
 #define PA2_GAMECONTROLLER_H
 
+#include <iostream>
 #include "BlockFall.h"
 
 using namespace std;
 
+class TraceWriter;
+
+enum GameCommand {
+    CMD_PRINT_GRID,
+    CMD_ROTATE_RIGHT,
+    CMD_ROTATE_LEFT,
+    CMD_MOVE_RIGHT,
+    CMD_MOVE_LEFT,
+    CMD_DROP,
+    CMD_GRAVITY_SWITCH,
+    CMD_SOFT_DROP, // Moves the block one row down, settles it if it cannot move
+    CMD_UNKNOWN
+};
+
+enum GameEnd {
+    END_GAME_OVER,        // The next block could not enter the grid
+    END_NO_MORE_BLOCKS,   // Every block has been placed
+    END_NO_MORE_COMMANDS  // The command source ran out first
+};
+
+// A whole commands file, parsed before the game starts
+struct CommandScript {
+    vector<GameCommand> commands;
+    vector<string> unknown_lines; // Text of each CMD_UNKNOWN command, in order
+};
+
 class GameController {
 public:
+    ostream *output = &cout; // Destination of everything the game prints (grids, banners, leaderboard)
+    TraceWriter *trace = nullptr; // If set, game events go here and the grid dumps before clears are skipped
+
+    // If set, play() reads the whole commands file and prepare()s the game before the first
+    // command, so the command loop itself never allocates
+    bool allocation_free = false;
+    unsigned long loop_allocations = 0; // operator new calls in the last play() loop (see AllocationCounter)
+
     bool play(BlockFall &game, const string &commands_file); // Function that implements the gameplay
 
+    bool play(BlockFall &game, const CommandScript &script);
+
+    static void read_commands(istream &in, CommandScript &script);
+
+    // Allocates up front what the command loop would otherwise allocate on first use: every grid
+    // tile, kernel scratch, print buffers and the leaderboard entry for the final score. Without
+    // allocate_tiles the tiles stay lazy: the loop then allocates a tile the first time a block
+    // lands in it, and an empty tile costs no memory
+    void prepare(BlockFall &game, bool allocate_tiles = true);
+
+    static GameCommand parse_command(const string &line);
+
+    static const char *command_name(GameCommand command); // Inverse of parse_command
+
+    void apply_command(BlockFall &game, GameCommand command);
+
+    // Records the score in the leaderboard and prints the final state
+    void finish_game(BlockFall &game, GameEnd end);
+
     static bool is_collision(BlockFall &game, int x_offset, int y_offset);
 
     static bool is_valid_position(BlockFall &game, int x_offset, int y_offset);
@@ -23,6 +77,8 @@ public:
 
     void drop_block(BlockFall &game);
 
+    void soft_drop(BlockFall &game);
+
     void update_grid(BlockFall &game);
 
     int check_completed_rows(BlockFall &game);
@@ -35,11 +91,25 @@ public:
 
     void print_grid(BlockFall &game);
 
-    void print_2d_vector(const vector<vector<int>> &vec) const;
+    // Renders grid row i with the active block drawn over it
+    void render_row(const BlockFall &game, int i, string &line) const;
+
+    void print_2d_vector(const Grid &grid) const;
+
+    // "Before clearing" grid dump, or a trace record when tracing
+    void report_clear(BlockFall &game, bool power_up);
 
     void print_2d_vectorBool(const vector<vector<bool>> &vec) const;
 
-    bool findMatrix(const vector<std::vector<int>> &source, const vector<std::vector<bool>> &target);
+    bool findMatrix(const Grid &source, const vector<std::vector<bool>> &target);
+
+    // Only considers placements of target that overlap region
+    bool findMatrix(const Grid &source, const vector<std::vector<bool>> &target, const DirtyRegion &region);
+
+private:
+    mutable string row_text; // Reused by the grid printers
+
+    static bool game_ended(BlockFall &game, GameEnd &end);
 };
 
 
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "GameHost.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// A client that stops reading is dropped once one reply has waited this long, so it cannot hold
+// up the other sessions on the worker that is sending to it
+const int SEND_TIMEOUT_MS = 2000;
+
+GameHost::GameHost(const string &socket_path, int worker_count, const string &leaderboard_file_name)
+        : socket_path(socket_path), worker_count(worker_count < 1 ? 1 : worker_count),
+          leaderboard_file_name(leaderboard_file_name) {
+    if (!leaderboard_file_name.empty()) {
+        leaderboard.read_from_file(leaderboard_file_name);
+    }
+}
+
+int GameHost::add_setup(shared_ptr<const GameSetup> setup) {
+    setups.push_back(setup);
+    return setups.size() - 1;
+}
+
+#ifdef __linux__
+
+bool GameHost::run() {
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (listen_fd < 0 || socket_path.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: unable to create the host socket: " << socket_path << endl;
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        return false;
+    }
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, (sockaddr *) &address, sizeof(address)) < 0 || listen(listen_fd, 128) < 0) {
+        cerr << "Error: unable to listen on " << socket_path << ": " << strerror(errno) << endl;
+        close(listen_fd);
+        return false;
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.fd = stop_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event);
+
+    sessions.clear();
+    sessions.resize(worker_count);
+    pool.reset(new WorkerPool(worker_count));
+    unordered_map<int, shared_ptr<Connection>> connections;
+
+    bool running = true;
+    while (running) {
+        epoll_event events[64];
+        int ready = epoll_wait(epoll_fd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int e = 0; e < ready; ++e) {
+            int fd = events[e].data.fd;
+            if (fd == stop_fd) {
+                running = false;
+            } else if (fd == listen_fd) {
+                int client_fd;
+                while ((client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+                    timeval timeout{SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000};
+                    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    shared_ptr<Connection> connection = make_shared<Connection>();
+                    connection->fd = client_fd;
+                    connections[client_fd] = connection;
+                    event.data.fd = client_fd;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event);
+                }
+            } else {
+                auto found = connections.find(fd);
+                if (found == connections.end()) {
+                    continue;
+                }
+                shared_ptr<Connection> connection = found->second;
+                handle_input(connection);
+                if (connection->hung_up) {
+                    // Unfinished games still count, like a command file that ran out. These jobs queue
+                    // behind the requests just dispatched, which reply first; the socket closes with
+                    // the last job's reference
+                    for (uint32_t id: connection->sessions) {
+                        int worker = id % worker_count;
+                        pool->submit(worker, [this, worker, id]() { end_session(worker, id, STATE_CLOSED); });
+                    }
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+                    connections.erase(found);
+                }
+            }
+        }
+    }
+
+    for (auto &entry: connections) {
+        for (uint32_t id: entry.second->sessions) {
+            int worker = id % worker_count;
+            pool->submit(worker, [this, worker, id]() { end_session(worker, id, STATE_CLOSED); });
+        }
+        disconnect(*entry.second);
+    }
+    pool.reset(); // Drains the queues, so every session has ended before the leaderboard is saved
+    sessions.clear();
+
+    close(epoll_fd);
+    close(stop_fd);
+    stop_fd = -1;
+    close(listen_fd);
+    unlink(socket_path.c_str());
+
+    if (!leaderboard_file_name.empty()) {
+        leaderboard.write_to_file(leaderboard_file_name);
+    }
+    return true;
+}
+
+void GameHost::stop() {
+    uint64_t one = 1;
+    if (stop_fd >= 0 && write(stop_fd, &one, sizeof(one)) < 0) {
+        // Already signalled
+    }
+}
+
+void GameHost::handle_input(const shared_ptr<Connection> &connection) {
+    char buffer[4096];
+    while (true) {
+        ssize_t count = recv(connection->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (count <= 0) {
+            connection->hung_up = true; // Requests already received are still answered below
+            break;
+        }
+        connection->pending.append(buffer, count);
+    }
+
+    // Dispatch every complete request, keep the tail for the next read
+    size_t offset = 0;
+    string &pending = connection->pending;
+    while (pending.size() - offset >= sizeof(HostRequestHeader)) {
+        HostRequestHeader header;
+        memcpy(&header, pending.data() + offset, sizeof(header));
+        if (pending.size() - offset - sizeof(header) < header.length) {
+            break;
+        }
+        dispatch(connection, header, pending.data() + offset + sizeof(header));
+        offset += sizeof(header) + header.length;
+    }
+    pending.erase(0, offset);
+}
+
+void GameHost::send_reply(Connection &connection, uint8_t status, uint8_t state, uint32_t session, uint64_t score) {
+    HostReply reply{status, state, 0, session, score};
+    lock_guard<mutex> guard(connection.send_lock);
+    const char *data = (const char *) &reply;
+    size_t size = sizeof(reply);
+    while (!connection.closed && size > 0) {
+        ssize_t sent = send(connection.fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Send timeout: later replies fail at once and the epoll thread sees the hang-up
+                shutdown(connection.fd, SHUT_RDWR);
+            }
+            return; // The epoll thread sees the broken connection on its next read
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+void GameHost::disconnect(Connection &connection) {
+    lock_guard<mutex> guard(connection.send_lock);
+    if (!connection.closed) {
+        connection.closed = true;
+        close(connection.fd);
+    }
+}
+
+GameHost::Connection::~Connection() {
+    if (!closed && fd >= 0) {
+        close(fd);
+    }
+}
+
+#else
+
+bool GameHost::run() {
+    cerr << "Error: the game host is only available on Linux." << endl;
+    return false;
+}
+
+void GameHost::stop() {}
+
+void GameHost::handle_input(const shared_ptr<Connection> &) {}
+
+void GameHost::send_reply(Connection &, uint8_t, uint8_t, uint32_t, uint64_t) {}
+
+void GameHost::disconnect(Connection &) {}
+
+GameHost::Connection::~Connection() {}
+
+#endif // __linux__
+
+void GameHost::dispatch(const shared_ptr<Connection> &connection, const HostRequestHeader &header, const char *payload) {
+    string body(payload, header.length);
+    uint32_t id = header.session;
+    if (header.type == MSG_OPEN) {
+        // Ids are handed out here so the owning worker is known before the session exists
+        id = next_session++;
+        if (id == 0) {
+            id = next_session++;
+        }
+        connection->sessions.push_back(id);
+    } else if (header.type != MSG_COMMANDS && header.type != MSG_CLOSE) {
+        send_reply(*connection, STATUS_BAD_REQUEST, STATE_CLOSED, id, 0);
+        return;
+    } else if (find(connection->sessions.begin(), connection->sessions.end(), id) == connection->sessions.end()) {
+        // A connection only drives the sessions it opened
+        send_reply(*connection, STATUS_NO_SESSION, STATE_CLOSED, id, 0);
+        return;
+    }
+
+    int worker = id % worker_count;
+    shared_ptr<Connection> owner = connection;
+    switch (header.type) {
+        case MSG_OPEN:
+            pool->submit(worker, [this, worker, id, owner, body]() { open_session(worker, id, owner, body); });
+            break;
+        case MSG_COMMANDS:
+            pool->submit(worker, [this, worker, id, owner, body]() { apply_commands(worker, id, owner, body); });
+            break;
+        default:
+            pool->submit(worker, [this, worker, id, owner]() { close_session(worker, id, owner); });
+            break;
+    }
+}
+
+void GameHost::open_session(int worker, uint32_t id, const shared_ptr<Connection> &connection, string payload) {
+    if (payload.size() < 2 || (unsigned char) payload[0] >= setups.size()) {
+        send_reply(*connection, STATUS_BAD_REQUEST, STATE_CLOSED, id, 0);
+        return;
+    }
+
+    unique_ptr<Session> session(new Session());
+    // No leaderboard file: the score goes to the host leaderboard when the session ends
+    session->game.reset(new BlockFall(setups[(unsigned char) payload[0]], payload[1] != 0, "", payload.substr(2)));
+    session->controller.output = &session->silent;
+    // Scratch and buffers are allocated here. Tiles stay lazy, so an idle session on a tall grid costs
+    // only the tiles its setup fills; a block landing in an empty tile allocates that tile once
+    session->controller.prepare(*session->game, false);
+
+    SessionState state = STATE_PLAYING;
+    if (!session->game->has_next_block(*session->game)) {
+        state = STATE_NO_MORE_BLOCKS;
+    }
+    sessions[worker][id] = std::move(session);
+    send_reply(*connection, STATUS_OK, state, id, 0);
+    if (state != STATE_PLAYING) {
+        end_session(worker, id, state);
+    }
+}
+
+void GameHost::apply_commands(int worker, uint32_t id, const shared_ptr<Connection> &connection, string payload) {
+    auto found = sessions[worker].find(id);
+    if (found == sessions[worker].end()) {
+        send_reply(*connection, STATUS_NO_SESSION, STATE_CLOSED, id, 0);
+        return;
+    }
+    Session &session = *found->second;
+    BlockFall &game = *session.game;
+
+    uint8_t status = STATUS_OK;
+    SessionState state = STATE_PLAYING;
+    for (char byte: payload) {
+        if ((unsigned char) byte >= CMD_UNKNOWN) {
+            status = STATUS_BAD_REQUEST; // The rest of the batch still runs, like an unknown line in a file
+            continue;
+        }
+        if (byte == CMD_PRINT_GRID) {
+            continue; // Nothing is printed in a session
+        }
+        session.controller.apply_command(game, (GameCommand) byte);
+        if (game.game_over) {
+            state = STATE_GAME_OVER;
+            break;
+        }
+        if (!game.has_next_block(game)) {
+            state = STATE_NO_MORE_BLOCKS;
+            break;
+        }
+    }
+
+    send_reply(*connection, status, state, id, game.current_score);
+    if (state != STATE_PLAYING) {
+        end_session(worker, id, state);
+    }
+}
+
+void GameHost::close_session(int worker, uint32_t id, const shared_ptr<Connection> &connection) {
+    auto found = sessions[worker].find(id);
+    if (found == sessions[worker].end()) {
+        send_reply(*connection, STATUS_NO_SESSION, STATE_CLOSED, id, 0);
+        return;
+    }
+    send_reply(*connection, STATUS_OK, STATE_CLOSED, id, found->second->game->current_score);
+    end_session(worker, id, STATE_CLOSED);
+}
+
+void GameHost::end_session(int worker, uint32_t id, SessionState state) {
+    auto found = sessions[worker].find(id);
+    if (found == sessions[worker].end()) {
+        return;
+    }
+    BlockFall &game = *found->second->game;
+    GameEnd end = state == STATE_GAME_OVER ? END_GAME_OVER :
+                  state == STATE_NO_MORE_BLOCKS ? END_NO_MORE_BLOCKS : END_NO_MORE_COMMANDS;
+    // Same bookkeeping as a file-driven game, into the session's own (empty) leaderboard and a null stream
+    found->second->controller.finish_game(game, end);
+
+    lock_guard<mutex> guard(leaderboard_lock);
+    leaderboard.insert_new_entry(leaderboard.create_entry(game.current_score, time(nullptr), game.player_name));
+    sessions[worker].erase(found);
+}
@@ -0,0 +1,125 @@
+#ifndef PA2_GAMEHOST_H
+#define PA2_GAMEHOST_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BlockFall.h"
+#include "GameController.h"
+#include "GameSetup.h"
+#include "Leaderboard.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+// Wire format (native byte order, the socket is local). Every request is an 8-byte header
+// followed by `length` payload bytes; every request gets exactly one 16-byte reply.
+enum HostMessage : uint8_t {
+    MSG_OPEN = 1,     // Payload: setup index (1 byte), gravity on (1 byte), player name. Reply carries the new session id
+    MSG_COMMANDS = 2, // Payload: one GameCommand value per byte, applied in order
+    MSG_CLOSE = 3     // Ends the session as if its commands ran out and records the score
+};
+
+enum HostStatus : uint8_t {
+    STATUS_OK = 0,
+    STATUS_BAD_REQUEST = 1, // Unknown type, bad setup index or an unknown command byte
+    STATUS_NO_SESSION = 2   // The session does not exist, has already ended or was opened on another connection
+};
+
+enum SessionState : uint8_t {
+    STATE_PLAYING = 0,
+    STATE_GAME_OVER = 1,
+    STATE_NO_MORE_BLOCKS = 2,
+    STATE_CLOSED = 3
+};
+
+struct HostRequestHeader {
+    uint8_t type;
+    uint8_t flags;   // Unused, must be 0
+    uint16_t length; // Payload bytes after the header
+    uint32_t session;
+};
+
+struct HostReply {
+    uint8_t status;
+    uint8_t state;
+    uint16_t reserved;
+    uint32_t session;
+    uint64_t score;
+};
+
+static_assert(sizeof(HostRequestHeader) == 8, "request header must stay 8 bytes");
+static_assert(sizeof(HostReply) == 16, "reply must stay 16 bytes");
+
+// Long-lived process serving many BlockFall sessions over a Unix domain socket (Linux only).
+// One epoll thread accepts connections and frames requests; each session belongs to one worker
+// (session id modulo worker count), so its commands run in order without locks. Sessions start
+// from setups parsed once with add_setup and shared read-only. Finished games go into one shared
+// leaderboard, which is written back when the host stops.
+class GameHost {
+public:
+    GameHost(const string &socket_path, int worker_count, const string &leaderboard_file_name);
+
+    // Must be called before run(); returns the index clients pass in MSG_OPEN
+    int add_setup(shared_ptr<const GameSetup> setup);
+
+    bool run(); // Serves until stop() is called. False if the socket could not be set up
+
+    void stop(); // Safe from any thread or a signal handler
+
+    Leaderboard leaderboard; // Guarded by leaderboard_lock while running
+
+private:
+    // The socket stays open until the last queued job holding the connection has replied, so
+    // requests sent just before a client half-closes still get their answers
+    struct Connection {
+        int fd = -1;
+        mutex send_lock; // Replies come from several workers
+        bool closed = false;
+        bool hung_up = false; // The peer stopped sending or the read failed (epoll thread only)
+        string pending;  // Bytes of a request not fully received yet (epoll thread only)
+        vector<uint32_t> sessions; // Sessions opened here, closed with the connection (epoll thread only)
+
+        ~Connection();
+    };
+
+    struct Session {
+        unique_ptr<BlockFall> game;
+        GameController controller;
+        ostream silent{nullptr}; // Sessions print nothing; results go back in replies
+    };
+
+    string socket_path;
+    int worker_count;
+    string leaderboard_file_name;
+    vector<shared_ptr<const GameSetup>> setups;
+    int stop_fd = -1;
+    uint32_t next_session = 1;
+    mutex leaderboard_lock;
+
+    // One map per worker, only ever touched by jobs running on that worker
+    vector<unordered_map<uint32_t, unique_ptr<Session>>> sessions;
+    unique_ptr<WorkerPool> pool;
+
+    void handle_input(const shared_ptr<Connection> &connection);
+
+    void dispatch(const shared_ptr<Connection> &connection, const HostRequestHeader &header, const char *payload);
+
+    void open_session(int worker, uint32_t id, const shared_ptr<Connection> &connection, string payload);
+
+    void apply_commands(int worker, uint32_t id, const shared_ptr<Connection> &connection, string payload);
+
+    void close_session(int worker, uint32_t id, const shared_ptr<Connection> &connection);
+
+    void end_session(int worker, uint32_t id, SessionState state);
+
+    static void send_reply(Connection &connection, uint8_t status, uint8_t state, uint32_t session, uint64_t score);
+
+    static void disconnect(Connection &connection);
+};
+
+#endif //PA2_GAMEHOST_H
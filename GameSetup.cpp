@@ -0,0 +1,190 @@
+#include "GameSetup.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+shared_ptr<const GameSetup> GameSetup::load(const string &grid_file_name, const string &blocks_file_name) {
+    shared_ptr<GameSetup> setup = make_shared<GameSetup>();
+    setup->initialize_grid(grid_file_name);
+    setup->read_blocks(blocks_file_name);
+    return setup;
+}
+
+shared_ptr<const GameSetup> GameSetup::create(const vector<vector<int>> &cells, const vector<vector<vector<bool>>> &shapes) {
+    shared_ptr<GameSetup> setup = make_shared<GameSetup>();
+    setup->rows = cells.size();
+    setup->cols = cells[0].size();
+    setup->grid = Grid(setup->rows, setup->cols);
+    for (int i = 0; i < setup->rows; ++i) {
+        for (int j = 0; j < setup->cols; ++j) {
+            setup->grid.set(i, j, cells[i][j]);
+        }
+    }
+    setup->link_blocks(shapes);
+    return setup;
+}
+
+GameSetup::~GameSetup() {
+    Block* current = initial_block;
+    while (current != nullptr) {
+        Block* next = current->next_block;
+        delete current->right_rotation->right_rotation;
+        delete current->right_rotation;
+        delete current->left_rotation;
+        delete current;
+        current = next;
+    }
+}
+
+void GameSetup::initialize_grid(const string &input_file) {
+    ifstream file(input_file);
+    if (!file.is_open()) {
+        cerr << "Error: Unable to open grid file." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+
+    // First pass sizes the grid, second pass fills it in place
+    std::string line;
+    rows = 0;
+    cols = 0;
+    while (std::getline(file, line)) {
+        if (rows == 0) {
+            std::istringstream iss(line);
+            int value;
+            while (iss >> value) {
+                cols++;
+            }
+        }
+        rows++;
+    }
+
+    grid = Grid(rows, cols);
+    file.clear();
+    file.seekg(0);
+
+    for (int i = 0; i < rows && std::getline(file, line); ++i) {
+        std::istringstream iss(line);
+        int value;
+        for (int j = 0; j < cols && iss >> value; ++j) {
+            grid.set(i, j, value);
+        }
+    }
+
+    file.close();
+
+}
+
+
+// Helper function to rotate a block 90 degrees clockwise
+vector<vector<bool>> GameSetup::rotate_block(const vector<vector<bool>> &block) {
+    int rows = block.size();
+    int cols = block[0].size();
+    vector<vector<bool>> rotated(cols, vector<bool>(rows, false));
+
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            rotated[j][rows - 1 - i] = block[i][j];
+        }
+    }
+
+    return rotated;
+}
+
+// Helper function to create rotations of a block
+Block* GameSetup::create_rotations(const vector<vector<bool>>& shape) {
+    Block* head = new Block();
+    head->shape = shape;
+
+    Block* current = head;
+
+    // Create three rotations (90, 180, and 270 degrees)
+    for (int i = 0; i < 3; ++i) {
+        Block* rotation = new Block();
+        rotation->shape = GameSetup::rotate_block(current->shape);
+        current->right_rotation = rotation;
+        rotation->left_rotation = current;
+        current = rotation;
+    }
+
+    // Link the last rotation to the initial block
+    head->left_rotation = current;
+    current->right_rotation = head;
+
+    return head;
+}
+
+void GameSetup::read_blocks(const string &input_file) {
+    ifstream file(input_file);
+    if (!file.is_open()) {
+        cerr << "Error: Unable to open blocks file: " << input_file << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Read each line (block) from the file
+    vector<vector<vector<bool>>> shapes;
+    string line;
+    vector<vector<bool>> block_shape;
+    while (getline(file, line)) {
+        // Skip lines that contain '[' character
+        if (line.find('[') != string::npos) {
+            line = line.substr(1);
+        }
+
+        if (line.size() == 0){
+            continue;
+        }
+
+        // If the line contains ']' character, it means the block is complete
+        bool complete = line.find(']') != string::npos;
+        if (complete) {
+            line = line.substr(0,line.length()-1);
+        }
+
+        // Parse the block shape from the line
+        istringstream iss(line);
+        char cell;
+        vector<bool> row;
+        while (iss >> cell) {
+            row.push_back(cell == '1');
+        }
+        block_shape.push_back(row);
+
+        if (complete) {
+            shapes.push_back(block_shape);
+            // Clear the block_shape vector for the next block
+            block_shape.clear();
+        }
+    }
+
+    file.close();
+
+    link_blocks(shapes);
+}
+
+void GameSetup::link_blocks(const vector<vector<vector<bool>>> &shapes) {
+    // The last shape is the power-up, every other one becomes a block with its rotations
+    power_up = shapes.back();
+
+    Block* tail = nullptr;  // To keep track of the last block in the list
+    for (size_t b = 0; b + 1 < shapes.size(); ++b) {
+        // Create rotations and link them
+        Block* block_rotations = create_rotations(shapes[b]);
+
+        // If this is the first block, set it as the initial_block
+        if (initial_block == nullptr) {
+            initial_block = block_rotations;
+        }
+
+        // If there is a tail (previous block), link it to the current block
+        if (tail != nullptr) {
+            tail->next_block = block_rotations;
+            tail->right_rotation->next_block = block_rotations;
+            tail->left_rotation->next_block = block_rotations;
+            tail->right_rotation->right_rotation->next_block = block_rotations;
+        }
+
+        // Update the tail to the last block in the current rotations
+        tail = block_rotations;
+    }
+}
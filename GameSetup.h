@@ -0,0 +1,43 @@
+#ifndef PA2_GAMESETUP_H
+#define PA2_GAMESETUP_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Block.h"
+#include "Grid.h"
+
+using namespace std;
+
+// Parsed grid and block files. A setup never changes once loaded, so any number of games (and
+// threads) can share one: each BlockFall copies the grid and points into the shared block list.
+class GameSetup {
+public:
+    // Parses both files once. Exits on unreadable files, like the game always has.
+    static shared_ptr<const GameSetup> load(const string &grid_file_name, const string &blocks_file_name);
+
+    // Builds a setup from cells already in memory. shapes are in blocks file order: the last one
+    // is the power-up.
+    static shared_ptr<const GameSetup> create(const vector<vector<int>> &cells, const vector<vector<vector<bool>>> &shapes);
+
+    GameSetup() = default;
+    GameSetup(const GameSetup &) = delete;
+    GameSetup &operator=(const GameSetup &) = delete;
+    ~GameSetup();
+
+    int rows = 0;  // Number of rows in the grid
+    int cols = 0;  // Number of columns in the grid
+    Grid grid;  // Initial game grid
+    vector<vector<bool>> power_up; // 2D matrix of the power-up shape
+    Block * initial_block = nullptr; // Head of the list of game blocks (with their rotations)
+
+    void initialize_grid(const string & input_file); // Initializes the grid using the command-line argument 1 in main
+    void read_blocks(const string & input_file); // Reads the input file and calls the read_block() function for each block;
+    void link_blocks(const vector<vector<vector<bool>>> &shapes); // Builds the block list and the power-up from parsed shapes
+    static vector<vector<bool>> rotate_block(const vector<vector<bool>>& block);
+
+    Block *create_rotations(const vector<vector<bool>> &shape);
+};
+
+#endif //PA2_GAMESETUP_H
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstring>
+#include "Grid.h"
+
+Grid::Grid(int rows, int cols) : rows(rows), cols(cols) {
+    int words = (cols + GRID_CELLS_PER_WORD - 1) / GRID_CELLS_PER_WORD;
+    int words_per_line = GRID_ROW_ALIGNMENT / sizeof(GridWord);
+    stride = (words + words_per_line - 1) / words_per_line * words_per_line;
+
+    int tile_count = (rows + GRID_TILE_ROWS - 1) / GRID_TILE_ROWS;
+    tiles.resize(tile_count);
+    occupancy.assign(tile_count, 0);
+    zero_row.assign(stride, 0);
+}
+
+int Grid::tile_rows(int t) const {
+    return min(GRID_TILE_ROWS, rows - t * GRID_TILE_ROWS);
+}
+
+GridWord *Grid::write_row(int r) {
+    int t = r / GRID_TILE_ROWS;
+    if (tiles[t].empty()) {
+        tiles[t].assign((size_t) tile_rows(t) * stride, 0);
+    }
+    occupancy[t] |= uint64_t(1) << (r % GRID_TILE_ROWS);
+    return tiles[t].data() + (r % GRID_TILE_ROWS) * stride;
+}
+
+void Grid::copy_row(int dst, int src) {
+    if (!row_occupied(src)) {
+        clear_row(dst);
+        return;
+    }
+    memcpy(write_row(dst), row(src), stride * sizeof(GridWord));
+}
+
+void Grid::clear_row(int r) {
+    int t = r / GRID_TILE_ROWS;
+    if (!row_occupied(r)) {
+        return;
+    }
+    memset(tiles[t].data() + (r % GRID_TILE_ROWS) * stride, 0, stride * sizeof(GridWord));
+    occupancy[t] &= ~(uint64_t(1) << (r % GRID_TILE_ROWS));
+}
+
+void Grid::trim() {
+    trim(0, tile_count());
+}
+
+void Grid::trim(int tile_begin, int tile_end) {
+    for (int t = tile_begin; t < tile_end; ++t) {
+        if (tiles[t].empty()) {
+            continue;
+        }
+        for (uint64_t bits = occupancy[t]; bits != 0; bits &= bits - 1) {
+            int r = __builtin_ctzll(bits);
+            const GridWord *cells = tiles[t].data() + r * stride;
+            if (std::all_of(cells, cells + stride, [](GridWord w) { return w == 0; })) {
+                occupancy[t] &= ~(uint64_t(1) << r);
+            }
+        }
+        if (occupancy[t] == 0 && !keep_tiles) {
+            GridRowStorage().swap(tiles[t]);
+        }
+    }
+}
+
+void Grid::allocate_all() {
+    for (int t = 0; t < tile_count(); ++t) {
+        if (tiles[t].empty()) {
+            tiles[t].assign((size_t) tile_rows(t) * stride, 0);
+        }
+    }
+    keep_tiles = true;
+}
+
+size_t Grid::allocated_bytes() const {
+    size_t bytes = 0;
+    for (const auto &tile: tiles) {
+        bytes += tile.size() * sizeof(GridWord);
+    }
+    return bytes;
+}
+
+bool Grid::operator==(const Grid &other) const {
+    if (rows != other.rows || cols != other.cols) {
+        return false;
+    }
+    for (int r = 0; r < rows; ++r) {
+        if (memcmp(row(r), other.row(r), stride * sizeof(GridWord)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,218 @@
+#ifndef PA2_GRID_H
+#define PA2_GRID_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+// Cell width of the game grid, chosen at compile time:
+//   1  - bit-packed, 64 cells per word (smallest footprint, occupancy only)
+//   8  - one byte per cell (default)
+//   16 - 16-bit cell IDs, room for colour/ownership information
+#ifndef GRID_CELL_BITS
+#define GRID_CELL_BITS 8
+#endif
+
+#if GRID_CELL_BITS == 1
+typedef uint64_t GridWord;
+#define GRID_CELLS_PER_WORD 64
+#elif GRID_CELL_BITS == 8
+typedef uint8_t GridWord;
+#define GRID_CELLS_PER_WORD 1
+#elif GRID_CELL_BITS == 16
+typedef uint16_t GridWord;
+#define GRID_CELLS_PER_WORD 1
+#else
+#error "GRID_CELL_BITS must be 1, 8 or 16"
+#endif
+
+// Every row starts on a cache line boundary, so row scans never straddle a line at the start
+// and the vector kernels can use aligned loads
+#define GRID_ROW_ALIGNMENT 64
+
+// Rows per tile. Each tile has a 64-bit occupancy bitmap, one bit per row.
+#define GRID_TILE_ROWS 64
+
+template <typename T>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(GRID_ROW_ALIGNMENT)));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, align_val_t(GRID_ROW_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+typedef vector<GridWord, AlignedAllocator<GridWord>> GridRowStorage;
+
+// Row-major game grid stored as tiles of GRID_TILE_ROWS full-width rows. A tile is only
+// allocated once something non-zero is written into it, so the empty space above the stack
+// costs neither memory nor scan time. Inside a tile rows are stride words apart; the padding
+// words past cols are always zero so the kernels can run whole-stride loops without tails.
+//
+// The occupancy bitmap of a tile is conservative: a cleared bit guarantees the row is empty,
+// a set bit means the row may hold filled cells. trim() makes it exact again.
+class Grid {
+public:
+    Grid() = default;
+    Grid(int rows, int cols);
+
+    int rows = 0;   // Number of rows
+    int cols = 0;   // Number of columns
+    int stride = 0; // Words per row, padded to GRID_ROW_ALIGNMENT bytes
+
+    int get(int row, int col) const {
+        const GridRowStorage &tile = tiles[row / GRID_TILE_ROWS];
+        if (tile.empty()) {
+            return 0;
+        }
+        const GridWord *cells = tile.data() + (row % GRID_TILE_ROWS) * stride;
+#if GRID_CELL_BITS == 1
+        return (cells[col >> 6] >> (col & 63)) & 1;
+#else
+        return cells[col];
+#endif
+    }
+
+    void set(int row, int col, int value) {
+        if (value == 0 && tiles[row / GRID_TILE_ROWS].empty()) {
+            return;
+        }
+        GridWord *cells = write_row(row);
+#if GRID_CELL_BITS == 1
+        GridWord bit = GridWord(1) << (col & 63);
+        cells[col >> 6] = value != 0 ? (cells[col >> 6] | bit) : (cells[col >> 6] & ~bit);
+#else
+        cells[col] = value;
+#endif
+    }
+
+    // Read-only row access. Rows of unallocated tiles read as a shared all-zero row.
+    const GridWord *row(int r) const {
+        const GridRowStorage &tile = tiles[r / GRID_TILE_ROWS];
+        return tile.empty() ? zero_row.data() : tile.data() + (r % GRID_TILE_ROWS) * stride;
+    }
+
+    // Writable row access. Allocates the tile if needed and marks the row as occupied.
+    GridWord *write_row(int r);
+
+    bool row_occupied(int r) const {
+        return (occupancy[r / GRID_TILE_ROWS] >> (r % GRID_TILE_ROWS)) & 1;
+    }
+
+    int tile_count() const {
+        return tiles.size();
+    }
+
+    bool tile_occupied(int t) const {
+        return occupancy[t] != 0;
+    }
+
+    // Calls fn(r) for every row in [row_begin, row_end) whose occupancy bit is set, skipping empty tiles
+    template <typename Fn>
+    void for_each_occupied_row(int row_begin, int row_end, Fn fn) const {
+        if (row_begin >= row_end) {
+            return;
+        }
+        for (int t = row_begin / GRID_TILE_ROWS; t <= (row_end - 1) / GRID_TILE_ROWS; ++t) {
+            uint64_t bits = occupancy[t];
+            int first = t * GRID_TILE_ROWS;
+            if (row_begin > first) {
+                bits &= ~uint64_t(0) << (row_begin - first);
+            }
+            if (row_end < first + GRID_TILE_ROWS) {
+                bits &= (uint64_t(1) << (row_end - first)) - 1;
+            }
+            for (; bits != 0; bits &= bits - 1) {
+                fn(first + __builtin_ctzll(bits));
+            }
+        }
+    }
+
+    template <typename Fn>
+    void for_each_occupied_row(Fn fn) const {
+        for_each_occupied_row(0, rows, fn);
+    }
+
+    void copy_row(int dst, int src);
+
+    void clear_row(int r);
+
+    // Drops stale occupancy bits and releases tiles that no longer hold any filled cell
+    void trim();
+
+    // trim() for tiles [tile_begin, tile_end) only. Calls on disjoint ranges may run concurrently.
+    void trim(int tile_begin, int tile_end);
+
+    // Allocates every tile now and keeps them allocated from then on (trim() only resets
+    // occupancy), so later writes never allocate. Costs the full grid size in memory.
+    void allocate_all();
+
+    size_t allocated_bytes() const;
+
+    bool operator==(const Grid &other) const;
+
+private:
+    vector<GridRowStorage> tiles; // Empty vector = tile not allocated
+    vector<uint64_t> occupancy;   // Bit r of tile t: row t * GRID_TILE_ROWS + r may hold filled cells
+    GridRowStorage zero_row;      // Backing for reads of unallocated rows
+    bool keep_tiles = false;      // Set by allocate_all
+
+    int tile_rows(int t) const;
+};
+
+// Rectangle of cells [row_begin, row_end) x [col_begin, col_end) that may have changed since a
+// pass last looked at the grid
+class DirtyRegion {
+public:
+    int row_begin = 0;
+    int row_end = 0;
+    int col_begin = 0;
+    int col_end = 0;
+
+    bool empty() const {
+        return row_begin >= row_end || col_begin >= col_end;
+    }
+
+    void add(int r0, int r1, int c0, int c1) {
+        if (r0 >= r1 || c0 >= c1) {
+            return;
+        }
+        if (empty()) {
+            row_begin = r0;
+            row_end = r1;
+            col_begin = c0;
+            col_end = c1;
+            return;
+        }
+        row_begin = min(row_begin, r0);
+        row_end = max(row_end, r1);
+        col_begin = min(col_begin, c0);
+        col_end = max(col_end, c1);
+    }
+
+    void clear() {
+        row_begin = row_end = col_begin = col_end = 0;
+    }
+};
+
+#endif //PA2_GRID_H
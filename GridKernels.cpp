@@ -0,0 +1,812 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include "GridKernels.h"
+#include "BlockFall.h"
+#include "WorkerPool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GRID_KERNELS_X86
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// CPU dispatch
+// ---------------------------------------------------------------------------------------------
+
+static GridKernels::Isa detect_isa() {
+#ifdef GRID_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return GridKernels::ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return GridKernels::ISA_SSE2;
+    }
+#endif
+    return GridKernels::ISA_SCALAR;
+}
+
+static GridKernels::Isa supported_isa = detect_isa();
+static GridKernels::Isa current_isa = supported_isa;
+
+GridKernels::Isa GridKernels::active_isa() {
+    return current_isa;
+}
+
+void GridKernels::set_isa(Isa isa) {
+    current_isa = isa > supported_isa ? supported_isa : isa;
+}
+
+const char *GridKernels::isa_name(Isa isa) {
+    switch (isa) {
+        case ISA_AVX2:
+            return "avx2";
+        case ISA_SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+static_assert(sizeof(occupiedCellChar) - 1 == GridKernels::GLYPH_BYTES, "glyphs must be GLYPH_BYTES long");
+static_assert(sizeof(unoccupiedCellChar) - 1 == GridKernels::GLYPH_BYTES, "glyphs must be GLYPH_BYTES long");
+
+void GridKernels::expand_row(const Grid &grid, int r, char *out) {
+    // Both glyphs are the same length, so each cell is a fixed-size copy into the line buffer
+    const GridWord *row = grid.row(r);
+    for (int j = 0; j < grid.cols; ++j) {
+#if GRID_CELL_BITS == 1
+        bool filled = (row[j >> 6] >> (j & 63)) & 1;
+#else
+        bool filled = row[j] != 0;
+#endif
+        memcpy(out + j * GLYPH_BYTES, filled ? occupiedCellChar : unoccupiedCellChar, GLYPH_BYTES);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Parallel passes for large grids
+// ---------------------------------------------------------------------------------------------
+
+// Written under kernel_pool_lock. Passes read them without it to skip the lock on small grids,
+// and read them again under it before they use the pool.
+static atomic<int> parallel_threads(thread::hardware_concurrency());
+static atomic<long> parallel_min_cells(1L << 22); // 4096 x 1024
+static shared_ptr<WorkerPool> kernel_pool;
+static mutex kernel_pool_lock;
+
+void GridKernels::set_parallel(int threads, long min_cells) {
+    lock_guard<mutex> guard(kernel_pool_lock);
+    parallel_threads = threads;
+    parallel_min_cells = min_cells;
+    kernel_pool.reset(); // Passes still running keep their own reference to the old pool
+}
+
+// How a grid-wide pass is split: column slices (1 = run inline) and the pool that runs them
+struct SlicePlan {
+    int slices = 1;
+    shared_ptr<WorkerPool> pool;
+};
+
+// Slices are whole cache lines, so the vector kernels keep their aligned loads
+static SlicePlan plan_slices(const Grid &grid) {
+    SlicePlan plan;
+    long cells = (long) grid.rows * grid.cols;
+    if (parallel_threads <= 1 || cells < parallel_min_cells) {
+        return plan;
+    }
+    lock_guard<mutex> guard(kernel_pool_lock);
+    int threads = parallel_threads;
+    int lines = grid.stride / (GRID_ROW_ALIGNMENT / sizeof(GridWord));
+    if (threads <= 1 || cells < parallel_min_cells || lines <= 1) {
+        return plan;
+    }
+    if (!kernel_pool) {
+        kernel_pool = make_shared<WorkerPool>(threads - 1);
+    }
+    plan.slices = min(threads, lines);
+    plan.pool = kernel_pool;
+    return plan;
+}
+
+// Column counts for a gravity pass. One buffer per thread, grown once and then reused, so
+// passes do not allocate.
+template <typename Count>
+static vector<Count> &column_counts(size_t size) {
+    static thread_local vector<Count> counts;
+    counts.assign(size, 0);
+    return counts;
+}
+
+// Row plans of the multi-threaded passes, one set per calling thread, reused like the counts.
+// Passes bind references to them before the slices start: a worker thread naming
+// parallel_scratch() would get its own, empty set.
+struct ParallelScratch {
+    vector<int> source;                                // pack_rows_parallel: source row of each row
+    vector<pair<GridWord *, const GridWord *>> moves;  // pack_rows_parallel: (destination, source or null)
+    vector<const GridWord *> occupied;                 // compact_parallel: rows to count
+    vector<GridWord *> cleared;                        // compact_parallel: rows that end up empty
+    vector<GridWord *> filled;                         // compact_parallel: rows rebuilt from the counts
+};
+
+static ParallelScratch &parallel_scratch() {
+    static thread_local ParallelScratch scratch;
+    return scratch;
+}
+
+void GridKernels::reserve_scratch(const Grid &grid) {
+    ParallelScratch &scratch = parallel_scratch();
+    scratch.source.reserve(grid.rows);
+    scratch.moves.reserve(grid.rows);
+    scratch.occupied.reserve(grid.rows);
+    scratch.cleared.reserve(grid.rows);
+    scratch.filled.reserve(grid.rows);
+    SlicePlan plan = plan_slices(grid);
+    if (plan.slices > 1) {
+        // Starts the pool and gives each worker a job queue now, instead of on the first pass
+        plan.pool->parallel_for(plan.slices, [](int) {});
+    }
+#if GRID_CELL_BITS == 1
+    column_counts<int>(grid.stride * 64);
+#else
+    column_counts<int>(grid.stride);
+    column_counts<uint16_t>(grid.stride);
+#endif
+}
+
+// Runs fn(word_begin, word_end) for each of the plan's column slices of the stride, in parallel
+template <typename Fn>
+static void for_each_slice(const Grid &grid, const SlicePlan &plan, Fn fn) {
+    int line = GRID_ROW_ALIGNMENT / sizeof(GridWord);
+    int lines = grid.stride / line;
+    int slices = plan.slices;
+    auto run_slice = [&](int s) {
+        fn(lines * s / slices * line, lines * (s + 1) / slices * line);
+    };
+    // One captured reference fits in std::function's inline storage, so the call does not allocate
+    plan.pool->parallel_for(slices, [&run_slice](int s) { run_slice(s); });
+}
+
+// Trims the grid with its tiles split over the pool
+static void trim_parallel(Grid &grid, const SlicePlan &plan) {
+    int tiles = grid.tile_count();
+    int slices = plan.slices;
+    auto trim_slice = [&](int s) {
+        grid.trim(tiles * s / slices, tiles * (s + 1) / slices);
+    };
+    plan.pool->parallel_for(slices, [&trim_slice](int s) { trim_slice(s); });
+}
+
+// Same result as pack_rows. Every row move is planned and every destination tile allocated
+// up front; then each thread carries out the whole plan on its own column slice, so the
+// threads never write the same words and never touch the tile tables.
+template <typename IsFull>
+static int pack_rows_parallel(Grid &grid, const SlicePlan &plan, IsFull is_full) {
+    bool top_full = is_full(0);
+    vector<int> &source = parallel_scratch().source; // Row each destination row is copied from, -1 = cleared
+    source.resize(grid.rows);
+    int lowest_removed = -1;
+    int write = grid.rows - 1;
+    for (int read = grid.rows - 1; read >= 0; --read) {
+        if (is_full(read)) {
+            lowest_removed = max(lowest_removed, read);
+        } else {
+            source[write--] = read;
+        }
+    }
+    if (lowest_removed < 0) {
+        return -1;
+    }
+    for (; write >= 0; --write) {
+        source[write] = top_full ? -1 : 0;
+    }
+
+    // Rows below the lowest removed row stay where they are. Bottom-up order is what lets the
+    // moves run in place: a row is always read before it is overwritten.
+    for (int dst = lowest_removed; dst >= 0; --dst) {
+        int src = source[dst];
+        if (src >= 0 && src != dst && grid.row_occupied(src)) {
+            grid.write_row(dst);
+        }
+    }
+    vector<pair<GridWord *, const GridWord *>> &moves = parallel_scratch().moves;
+    moves.clear();
+    for (int dst = lowest_removed; dst >= 0; --dst) {
+        int src = source[dst];
+        if (src == dst || !grid.row_occupied(dst)) {
+            continue; // Unchanged, or empty and staying empty (sources of allocated rows are occupied)
+        }
+        bool copies = src >= 0 && grid.row_occupied(src);
+        moves.push_back(make_pair(grid.write_row(dst), copies ? grid.row(src) : nullptr));
+    }
+
+    for_each_slice(grid, plan, [&](int word_begin, int word_end) {
+        size_t bytes = (word_end - word_begin) * sizeof(GridWord);
+        for (const auto &move: moves) {
+            if (move.second != nullptr) {
+                memcpy(move.first + word_begin, move.second + word_begin, bytes);
+            } else {
+                memset(move.first + word_begin, 0, bytes);
+            }
+        }
+    });
+    trim_parallel(grid, plan);
+    return lowest_removed;
+}
+
+// Full-width gravity split over column slices: each slice counts its own columns over every
+// occupied row, then rewrites its own columns of every row. The rows to rewrite are allocated
+// before the slices start. add_slice(row, counts, word_begin, word_end) and
+// fill_slice(row, counts, threshold, word_begin, word_end) work on one slice of one row.
+template <typename Count, typename AddSlice, typename FillSlice>
+static void compact_parallel(Grid &grid, const SlicePlan &plan, vector<Count> &counts, AddSlice add_slice,
+                             FillSlice fill_slice) {
+    ParallelScratch &scratch = parallel_scratch();
+    vector<const GridWord *> &occupied = scratch.occupied;
+    occupied.clear();
+    grid.for_each_occupied_row([&](int r) {
+        occupied.push_back(grid.row(r));
+    });
+    for_each_slice(grid, plan, [&](int word_begin, int word_end) {
+        for (const GridWord *row: occupied) {
+            add_slice(row, counts.data(), word_begin, word_end);
+        }
+    });
+    int top = grid.rows - *max_element(counts.begin(), counts.end());
+
+    // Rows above the tallest column end up empty, the rest are rebuilt from the counts
+    vector<GridWord *> &cleared = scratch.cleared;
+    cleared.clear();
+    grid.for_each_occupied_row(0, top, [&](int r) {
+        cleared.push_back(grid.write_row(r));
+    });
+    vector<GridWord *> &filled = scratch.filled;
+    filled.clear();
+    for (int i = top; i < grid.rows; ++i) {
+        filled.push_back(grid.write_row(i));
+    }
+    for_each_slice(grid, plan, [&](int word_begin, int word_end) {
+        for (GridWord *row: cleared) {
+            memset(row + word_begin, 0, (word_end - word_begin) * sizeof(GridWord));
+        }
+        for (size_t k = 0; k < filled.size(); ++k) {
+            fill_slice(filled[k], counts.data(), grid.rows - top - (int) k, word_begin, word_end);
+        }
+    });
+    trim_parallel(grid, plan);
+}
+
+// Packs the rows that are not full to the bottom. Matches the original top-down clear: the
+// freed rows on top end up as copies of row 0, or empty if row 0 itself was full. Rows in
+// empty tiles are never full and copying them only clears allocated destinations.
+template <typename RowIsFull>
+static int pack_rows(Grid &grid, int row_begin, int row_end, RowIsFull row_is_full) {
+    auto is_full = [&](int r) {
+        return r >= row_begin && r < row_end && grid.row_occupied(r) && row_is_full(grid.row(r));
+    };
+    SlicePlan plan = plan_slices(grid);
+    if (plan.slices > 1) {
+        return pack_rows_parallel(grid, plan, is_full);
+    }
+    bool top_full = is_full(0);
+
+    int lowest_removed = -1;
+    int write = grid.rows - 1;
+    for (int read = grid.rows - 1; read >= 0; --read) {
+        if (is_full(read)) {
+            lowest_removed = max(lowest_removed, read);
+            continue;
+        }
+        if (write != read) {
+            grid.copy_row(write, read);
+        }
+        write--;
+    }
+    for (; write >= 0; --write) {
+        if (top_full) {
+            grid.clear_row(write);
+        } else if (write != 0) {
+            grid.copy_row(write, 0);
+        }
+    }
+    grid.trim();
+    return lowest_removed;
+}
+
+int GridKernels::remove_completed_rows(Grid &grid, int row_begin, int row_end) {
+#if GRID_CELL_BITS != 1
+    switch (grid.cols) {
+        case 8:
+            return pack_rows(grid, row_begin, row_end, FixedWidthEngine<8>::row_is_full);
+        case 10:
+            return pack_rows(grid, row_begin, row_end, FixedWidthEngine<10>::row_is_full);
+        case 12:
+            return pack_rows(grid, row_begin, row_end, FixedWidthEngine<12>::row_is_full);
+        case 16:
+            return pack_rows(grid, row_begin, row_end, FixedWidthEngine<16>::row_is_full);
+        default:
+            break;
+    }
+#endif
+
+    int cols = grid.cols;
+    return pack_rows(grid, row_begin, row_end, [cols](const GridWord *row) {
+        return row_is_full(row, cols);
+    });
+}
+
+// Column-range gravity for the narrow strips touched by a single placement: cell by cell over
+// the occupied rows, which is cheaper than a whole-stride pass for a few columns
+static void compact_column_range(Grid &grid, int col_begin, int col_end) {
+    for (int j = col_begin; j < col_end; ++j) {
+        int count = 0;
+        grid.for_each_occupied_row([&](int r) {
+            if (grid.get(r, j) == 1) {
+                count++;
+            }
+            grid.set(r, j, 0);
+        });
+        for (int i = grid.rows - count; i < grid.rows; ++i) {
+            grid.set(i, j, 1);
+        }
+    }
+}
+
+#if GRID_CELL_BITS == 1
+
+// ---------------------------------------------------------------------------------------------
+// Bit-packed kernels. A word already covers 64 cells, so these stay scalar on every CPU.
+// ---------------------------------------------------------------------------------------------
+
+bool GridKernels::row_is_full(const GridWord *row, int cols) {
+    int full_words = cols / 64;
+    for (int w = 0; w < full_words; ++w) {
+        if (row[w] != ~GridWord(0)) {
+            return false;
+        }
+    }
+    int rest = cols % 64;
+    if (rest != 0) {
+        GridWord mask = (GridWord(1) << rest) - 1;
+        return (row[full_words] & mask) == mask;
+    }
+    return true;
+}
+
+int GridKernels::count_completed_rows(const Grid &grid, int row_begin, int row_end) {
+    int completed_rows = 0;
+    grid.for_each_occupied_row(row_begin, row_end, [&](int r) {
+        completed_rows += row_is_full(grid.row(r), grid.cols);
+    });
+    return completed_rows;
+}
+
+int GridKernels::count_and_clear_ones(Grid &grid) {
+    int count = 0;
+    grid.for_each_occupied_row([&](int r) {
+        GridWord *row = grid.write_row(r);
+        for (int w = 0; w < grid.stride; ++w) {
+            count += __builtin_popcountll(row[w]);
+            row[w] = 0;
+        }
+    });
+    grid.trim();
+    return count;
+}
+
+void GridKernels::compact_columns(Grid &grid, int col_begin, int col_end) {
+    if (col_begin > 0 || col_end < grid.cols) {
+        compact_column_range(grid, col_begin, col_end);
+        return;
+    }
+
+    vector<int> &counts = column_counts<int>(grid.stride * 64);
+    SlicePlan plan = plan_slices(grid);
+    if (plan.slices > 1) {
+        compact_parallel(grid, plan, counts, [](const GridWord *row, int *counts, int word_begin, int word_end) {
+            for (int w = word_begin; w < word_end; ++w) {
+                for (GridWord bits = row[w]; bits != 0; bits &= bits - 1) {
+                    counts[w * 64 + __builtin_ctzll(bits)]++;
+                }
+            }
+        }, [](GridWord *row, const int *counts, int threshold, int word_begin, int word_end) {
+            for (int w = word_begin; w < word_end; ++w) {
+                GridWord word = 0;
+                for (int b = 0; b < 64; ++b) {
+                    word |= GridWord(counts[w * 64 + b] >= threshold) << b;
+                }
+                row[w] = word;
+            }
+        });
+        return;
+    }
+    grid.for_each_occupied_row([&](int r) {
+        const GridWord *row = grid.row(r);
+        for (int w = 0; w < grid.stride; ++w) {
+            for (GridWord bits = row[w]; bits != 0; bits &= bits - 1) {
+                counts[w * 64 + __builtin_ctzll(bits)]++;
+            }
+        }
+    });
+    int top = grid.rows - *max_element(counts.begin(), counts.end());
+
+    // Row i is filled in column j when the column holds more than (rows - 1 - i) cells
+    for (int i = 0; i < top; ++i) {
+        grid.clear_row(i);
+    }
+    for (int i = top; i < grid.rows; ++i) {
+        GridWord *row = grid.write_row(i);
+        int threshold = grid.rows - i;
+        for (int w = 0; w < grid.stride; ++w) {
+            GridWord word = 0;
+            for (int b = 0; b < 64; ++b) {
+                word |= GridWord(counts[w * 64 + b] >= threshold) << b;
+            }
+            row[w] = word;
+        }
+    }
+    grid.trim();
+}
+
+#else
+
+// ---------------------------------------------------------------------------------------------
+// Scalar kernels (portable fallback, also used for the tails of the vector loops)
+// ---------------------------------------------------------------------------------------------
+
+static bool row_is_full_scalar(const GridWord *row, int cols) {
+    for (int j = 0; j < cols; ++j) {
+        if (row[j] == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int count_and_clear_ones_scalar(GridWord *row, int n) {
+    int count = 0;
+    for (int j = 0; j < n; ++j) {
+        if (row[j] == 1) {
+            row[j] = 0;
+            count++;
+        }
+    }
+    return count;
+}
+
+template <typename Count>
+static void add_ones_scalar(const GridWord *row, Count *counts, int n) {
+    for (int j = 0; j < n; ++j) {
+        counts[j] += row[j] == 1;
+    }
+}
+
+template <typename Count>
+static void fill_from_counts_scalar(GridWord *row, const Count *counts, int threshold, int n) {
+    for (int j = 0; j < n; ++j) {
+        row[j] = counts[j] >= threshold ? 1 : 0;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// SSE2 / AVX2 kernels. Rows are GRID_ROW_ALIGNMENT aligned and stride-padded, so whole-stride
+// loops use aligned loads and need no tail; only the full-row scan stops at cols.
+// ---------------------------------------------------------------------------------------------
+
+#ifdef GRID_KERNELS_X86
+
+#if GRID_CELL_BITS == 8
+#define SSE_CELLS_SET1 _mm_set1_epi8
+#define SSE_CELLS_CMPEQ _mm_cmpeq_epi8
+#define AVX_CELLS_SET1 _mm256_set1_epi8
+#define AVX_CELLS_CMPEQ _mm256_cmpeq_epi8
+#else
+#define SSE_CELLS_SET1 _mm_set1_epi16
+#define SSE_CELLS_CMPEQ _mm_cmpeq_epi16
+#define AVX_CELLS_SET1 _mm256_set1_epi16
+#define AVX_CELLS_CMPEQ _mm256_cmpeq_epi16
+#endif
+
+const int SSE_CELLS = 16 / sizeof(GridWord);
+const int AVX_CELLS = 32 / sizeof(GridWord);
+
+// Sums 0/1 cells into 32-bit lanes
+__attribute__((target("sse2")))
+static inline __m128i sum_cells_sse2(__m128i ones) {
+#if GRID_CELL_BITS == 8
+    return _mm_sad_epu8(ones, _mm_setzero_si128());
+#else
+    return _mm_madd_epi16(ones, _mm_set1_epi16(1));
+#endif
+}
+
+__attribute__((target("avx2")))
+static inline __m256i sum_cells_avx2(__m256i ones) {
+#if GRID_CELL_BITS == 8
+    return _mm256_sad_epu8(ones, _mm256_setzero_si256());
+#else
+    return _mm256_madd_epi16(ones, _mm256_set1_epi16(1));
+#endif
+}
+
+__attribute__((target("sse2")))
+static bool row_is_full_sse2(const GridWord *row, int cols) {
+    const __m128i zero = _mm_setzero_si128();
+    int j = 0;
+    for (; j + SSE_CELLS <= cols; j += SSE_CELLS) {
+        __m128i v = _mm_load_si128((const __m128i *) (row + j));
+        if (_mm_movemask_epi8(SSE_CELLS_CMPEQ(v, zero))) {
+            return false;
+        }
+    }
+    return row_is_full_scalar(row + j, cols - j);
+}
+
+__attribute__((target("avx2")))
+static bool row_is_full_avx2(const GridWord *row, int cols) {
+    const __m256i zero = _mm256_setzero_si256();
+    int j = 0;
+    for (; j + 2 * AVX_CELLS <= cols; j += 2 * AVX_CELLS) {
+        __m256i a = AVX_CELLS_CMPEQ(_mm256_load_si256((const __m256i *) (row + j)), zero);
+        __m256i b = AVX_CELLS_CMPEQ(_mm256_load_si256((const __m256i *) (row + j + AVX_CELLS)), zero);
+        __m256i any = _mm256_or_si256(a, b);
+        if (!_mm256_testz_si256(any, any)) {
+            return false;
+        }
+    }
+    return row_is_full_scalar(row + j, cols - j);
+}
+
+__attribute__((target("sse2")))
+static int count_and_clear_ones_sse2(GridWord *row, int n) {
+    const __m128i one = SSE_CELLS_SET1(1);
+    __m128i acc = _mm_setzero_si128();
+    for (int j = 0; j < n; j += SSE_CELLS) {
+        __m128i v = _mm_load_si128((const __m128i *) (row + j));
+        __m128i match = SSE_CELLS_CMPEQ(v, one);
+        acc = _mm_add_epi32(acc, sum_cells_sse2(_mm_and_si128(match, one)));
+        _mm_store_si128((__m128i *) (row + j), _mm_andnot_si128(match, v));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+static int count_and_clear_ones_avx2(GridWord *row, int n) {
+    const __m256i one = AVX_CELLS_SET1(1);
+    __m256i acc = _mm256_setzero_si256();
+    for (int j = 0; j < n; j += AVX_CELLS) {
+        __m256i v = _mm256_load_si256((const __m256i *) (row + j));
+        __m256i match = AVX_CELLS_CMPEQ(v, one);
+        acc = _mm256_add_epi32(acc, sum_cells_avx2(_mm256_and_si256(match, one)));
+        _mm256_store_si256((__m256i *) (row + j), _mm256_andnot_si256(match, v));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    int count = 0;
+    for (int lane: lanes) {
+        count += lane;
+    }
+    return count;
+}
+
+// Column counts are 16-bit so they line up with the cells; compact_columns only uses these
+// kernels while rows fit in a signed 16-bit compare.
+__attribute__((target("sse2")))
+static void add_ones_sse2(const GridWord *row, uint16_t *counts, int n) {
+#if GRID_CELL_BITS == 8
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    for (int j = 0; j < n; j += 16) {
+        __m128i ones = _mm_and_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) (row + j)), one), one);
+        __m128i *lo = (__m128i *) (counts + j);
+        __m128i *hi = (__m128i *) (counts + j + 8);
+        _mm_storeu_si128(lo, _mm_add_epi16(_mm_loadu_si128(lo), _mm_unpacklo_epi8(ones, zero)));
+        _mm_storeu_si128(hi, _mm_add_epi16(_mm_loadu_si128(hi), _mm_unpackhi_epi8(ones, zero)));
+    }
+#else
+    const __m128i one = _mm_set1_epi16(1);
+    for (int j = 0; j < n; j += 8) {
+        __m128i match = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *) (row + j)), one);
+        __m128i *c = (__m128i *) (counts + j);
+        _mm_storeu_si128(c, _mm_sub_epi16(_mm_loadu_si128(c), match));
+    }
+#endif
+}
+
+__attribute__((target("avx2")))
+static void add_ones_avx2(const GridWord *row, uint16_t *counts, int n) {
+#if GRID_CELL_BITS == 8
+    const __m128i one = _mm_set1_epi8(1);
+    for (int j = 0; j < n; j += 16) {
+        __m128i ones = _mm_and_si128(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) (row + j)), one), one);
+        __m256i *c = (__m256i *) (counts + j);
+        _mm256_storeu_si256(c, _mm256_add_epi16(_mm256_loadu_si256(c), _mm256_cvtepu8_epi16(ones)));
+    }
+#else
+    const __m256i one = _mm256_set1_epi16(1);
+    for (int j = 0; j < n; j += 16) {
+        __m256i match = _mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *) (row + j)), one);
+        __m256i *c = (__m256i *) (counts + j);
+        _mm256_storeu_si256(c, _mm256_sub_epi16(_mm256_loadu_si256(c), match));
+    }
+#endif
+}
+
+__attribute__((target("sse2")))
+static void fill_from_counts_sse2(GridWord *row, const uint16_t *counts, int threshold, int n) {
+    const __m128i below = _mm_set1_epi16(threshold - 1);
+#if GRID_CELL_BITS == 8
+    const __m128i one = _mm_set1_epi8(1);
+    for (int j = 0; j < n; j += 16) {
+        __m128i lo = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *) (counts + j)), below);
+        __m128i hi = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *) (counts + j + 8)), below);
+        _mm_store_si128((__m128i *) (row + j), _mm_and_si128(_mm_packs_epi16(lo, hi), one));
+    }
+#else
+    const __m128i one = _mm_set1_epi16(1);
+    for (int j = 0; j < n; j += 8) {
+        __m128i filled = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *) (counts + j)), below);
+        _mm_store_si128((__m128i *) (row + j), _mm_and_si128(filled, one));
+    }
+#endif
+}
+
+__attribute__((target("avx2")))
+static void fill_from_counts_avx2(GridWord *row, const uint16_t *counts, int threshold, int n) {
+    const __m256i below = _mm256_set1_epi16(threshold - 1);
+#if GRID_CELL_BITS == 8
+    const __m128i one = _mm_set1_epi8(1);
+    for (int j = 0; j < n; j += 16) {
+        __m256i filled = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i *) (counts + j)), below);
+        __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(filled), _mm256_extracti128_si256(filled, 1));
+        _mm_store_si128((__m128i *) (row + j), _mm_and_si128(packed, one));
+    }
+#else
+    const __m256i one = _mm256_set1_epi16(1);
+    for (int j = 0; j < n; j += 16) {
+        __m256i filled = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i *) (counts + j)), below);
+        _mm256_store_si256((__m256i *) (row + j), _mm256_and_si256(filled, one));
+    }
+#endif
+}
+
+#endif // GRID_KERNELS_X86
+
+// ---------------------------------------------------------------------------------------------
+// Dispatching entry points
+// ---------------------------------------------------------------------------------------------
+
+bool GridKernels::row_is_full(const GridWord *row, int cols) {
+    switch (current_isa) {
+#ifdef GRID_KERNELS_X86
+        case ISA_AVX2:
+            return row_is_full_avx2(row, cols);
+        case ISA_SSE2:
+            return row_is_full_sse2(row, cols);
+#endif
+        default:
+            return row_is_full_scalar(row, cols);
+    }
+}
+
+static int count_and_clear_ones_row(GridWord *row, int n) {
+    switch (current_isa) {
+#ifdef GRID_KERNELS_X86
+        case GridKernels::ISA_AVX2:
+            return count_and_clear_ones_avx2(row, n);
+        case GridKernels::ISA_SSE2:
+            return count_and_clear_ones_sse2(row, n);
+#endif
+        default:
+            return count_and_clear_ones_scalar(row, n);
+    }
+}
+
+static void add_ones(const GridWord *row, uint16_t *counts, int n) {
+    switch (current_isa) {
+#ifdef GRID_KERNELS_X86
+        case GridKernels::ISA_AVX2:
+            add_ones_avx2(row, counts, n);
+            return;
+        case GridKernels::ISA_SSE2:
+            add_ones_sse2(row, counts, n);
+            return;
+#endif
+        default:
+            add_ones_scalar(row, counts, n);
+    }
+}
+
+static void fill_from_counts(GridWord *row, const uint16_t *counts, int threshold, int n) {
+    switch (current_isa) {
+#ifdef GRID_KERNELS_X86
+        case GridKernels::ISA_AVX2:
+            fill_from_counts_avx2(row, counts, threshold, n);
+            return;
+        case GridKernels::ISA_SSE2:
+            fill_from_counts_sse2(row, counts, threshold, n);
+            return;
+#endif
+        default:
+            fill_from_counts_scalar(row, counts, threshold, n);
+    }
+}
+
+int GridKernels::count_completed_rows(const Grid &grid, int row_begin, int row_end) {
+    // Supported widths: 10 is the standard board and covers most games, the others are common variants
+    switch (grid.cols) {
+        case 8:
+            return FixedWidthEngine<8>::count_completed_rows(grid, row_begin, row_end);
+        case 10:
+            return FixedWidthEngine<10>::count_completed_rows(grid, row_begin, row_end);
+        case 12:
+            return FixedWidthEngine<12>::count_completed_rows(grid, row_begin, row_end);
+        case 16:
+            return FixedWidthEngine<16>::count_completed_rows(grid, row_begin, row_end);
+        default:
+            break;
+    }
+
+    int completed_rows = 0;
+    grid.for_each_occupied_row(row_begin, row_end, [&](int r) {
+        completed_rows += row_is_full(grid.row(r), grid.cols);
+    });
+    return completed_rows;
+}
+
+int GridKernels::count_and_clear_ones(Grid &grid) {
+    int count = 0;
+    grid.for_each_occupied_row([&](int r) {
+        count += count_and_clear_ones_row(grid.write_row(r), grid.stride);
+    });
+    grid.trim();
+    return count;
+}
+
+// Rewrites the grid from per-column counts: rows above the tallest column are cleared, the rest
+// are filled where the column holds more than (rows - 1 - i) cells
+template <typename Count, typename AddOnes, typename FillFromCounts>
+static void compact_with_counts(Grid &grid, AddOnes add_ones, FillFromCounts fill_from_counts) {
+    vector<Count> &counts = column_counts<Count>(grid.stride);
+    SlicePlan plan = plan_slices(grid);
+    if (plan.slices > 1) {
+        compact_parallel(grid, plan, counts, [&](const GridWord *row, Count *counts, int word_begin, int word_end) {
+            add_ones(row + word_begin, counts + word_begin, word_end - word_begin);
+        }, [&](GridWord *row, const Count *counts, int threshold, int word_begin, int word_end) {
+            fill_from_counts(row + word_begin, counts + word_begin, threshold, word_end - word_begin);
+        });
+        return;
+    }
+    grid.for_each_occupied_row([&](int r) {
+        add_ones(grid.row(r), counts.data(), grid.stride);
+    });
+    int top = grid.rows - *max_element(counts.begin(), counts.end());
+
+    for (int i = 0; i < top; ++i) {
+        grid.clear_row(i);
+    }
+    for (int i = top; i < grid.rows; ++i) {
+        fill_from_counts(grid.write_row(i), counts.data(), grid.rows - i, grid.stride);
+    }
+    grid.trim();
+}
+
+void GridKernels::compact_columns(Grid &grid, int col_begin, int col_end) {
+    if (col_begin > 0 || col_end < grid.cols) {
+        compact_column_range(grid, col_begin, col_end);
+        return;
+    }
+    if (grid.rows > INT16_MAX) {
+        // Column counts would overflow the 16-bit lanes
+        compact_with_counts<int>(grid, add_ones_scalar<int>, fill_from_counts_scalar<int>);
+        return;
+    }
+    compact_with_counts<uint16_t>(grid, add_ones, fill_from_counts);
+}
+
+#endif // GRID_CELL_BITS == 1
@@ -0,0 +1,78 @@
+#ifndef PA2_GRIDKERNELS_H
+#define PA2_GRIDKERNELS_H
+
+#include "Grid.h"
+
+using namespace std;
+
+// Row kernels specialized on a compile-time grid width. With COLS known the compiler fully
+// unrolls the per-row loops and keeps the row in registers. Row count stays dynamic because
+// grid heights vary much more than widths. Only used for byte/16-bit cells: in the bit-packed
+// layout a row of up to 64 cells is already a single word.
+template <int COLS>
+class FixedWidthEngine {
+public:
+    static bool row_is_full(const GridWord *row) {
+        bool full = true;
+        for (int j = 0; j < COLS; ++j) {
+            full &= row[j] != 0;
+        }
+        return full;
+    }
+
+    static int count_completed_rows(const Grid &grid, int row_begin, int row_end) {
+        int completed_rows = 0;
+        grid.for_each_occupied_row(row_begin, row_end, [&](int r) {
+            completed_rows += row_is_full(grid.row(r));
+        });
+        return completed_rows;
+    }
+};
+
+namespace GridKernels {
+    // Instruction set used by the wide-grid kernels. Picked from the running CPU on first use.
+    enum Isa {
+        ISA_SCALAR,
+        ISA_SSE2,
+        ISA_AVX2
+    };
+
+    Isa active_isa();
+
+    void set_isa(Isa isa); // Forces a kernel level (clamped to what the CPU supports), mainly for comparisons
+
+    const char *isa_name(Isa isa);
+
+    const int GLYPH_BYTES = 6;
+
+    bool row_is_full(const GridWord *row, int cols);
+
+    // Expands row r into occupied/unoccupied glyphs. out must hold cols * GLYPH_BYTES chars.
+    void expand_row(const Grid &grid, int r, char *out);
+
+    // Grid-wide passes: use a FixedWidthEngine instantiation when the width is one of the
+    // supported sizes and the vector kernels otherwise. Full rows are only looked for in
+    // [row_begin, row_end); the caller guarantees there are none outside it.
+    int count_completed_rows(const Grid &grid, int row_begin, int row_end);
+
+    // Returns the lowest removed row (every row above it has moved), or -1 if nothing was removed
+    int remove_completed_rows(Grid &grid, int row_begin, int row_end);
+
+    // Counts the cells equal to 1 and sets them to 0
+    int count_and_clear_ones(Grid &grid);
+
+    // Settles every filled cell in columns [col_begin, col_end) to the bottom of its column
+    // (the fixed point of the gravity sweep)
+    void compact_columns(Grid &grid, int col_begin, int col_end);
+
+    // Sizes the calling thread's scratch buffers for grid and, if passes over grid are split
+    // across threads, starts the pool, so later passes over grid do not allocate
+    void reserve_scratch(const Grid &grid);
+
+    // Row removal and full-width gravity on grids of at least min_cells cells are split into
+    // column slices run on a persistent pool of `threads` threads (started on first use).
+    // threads <= 1 keeps every pass single-threaded. Configure before any game runs.
+    void set_parallel(int threads, long min_cells);
+}
+
+#endif //PA2_GRIDKERNELS_H
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include "InteractiveController.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+InteractiveController::InteractiveController(int tick_ms) : tick_ms(tick_ms) {}
+
+#ifdef __linux__
+
+// Puts the terminal in raw mode (no line buffering, no echo, no signal keys) for its lifetime
+class RawTerminal {
+public:
+    RawTerminal() {
+        ok = tcgetattr(STDIN_FILENO, &saved) == 0;
+        if (!ok) {
+            return;
+        }
+        termios raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        ok = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+
+    ~RawTerminal() {
+        if (ok) {
+            tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        }
+    }
+
+    bool ok = false;
+
+private:
+    termios saved{};
+};
+
+static long now_ns() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+bool InteractiveController::play(BlockFall &game) {
+    if (tick_ms <= 0) {
+        cerr << "Error: the interactive tick must be a positive number of milliseconds." << endl;
+        return false;
+    }
+    if (!isatty(STDIN_FILENO)) {
+        cerr << "Error: interactive mode needs a terminal on stdin." << endl;
+        return false;
+    }
+
+    // Everything the controller would print (clear dumps, banners) would tear the frame
+    ostream silent(nullptr);
+    controller.output = &silent;
+
+    frame.assign(game.rows + 1, string());
+    latencies_ns.clear();
+    latencies_ns.reserve(4096);
+    piece_row_begin = piece_row_end = 0;
+    key_count = 0;
+
+    {
+        RawTerminal terminal;
+        if (!terminal.ok) {
+            cerr << "Error: unable to switch the terminal to raw mode." << endl;
+            controller.output = &cout;
+            return false;
+        }
+
+        int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        itimerspec interval{};
+        interval.it_interval.tv_sec = tick_ms / 1000;
+        interval.it_interval.tv_nsec = (tick_ms % 1000) * 1000000L;
+        interval.it_value = interval.it_interval;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        bool ready = timer_fd >= 0 && epoll_fd >= 0 && timerfd_settime(timer_fd, 0, &interval, nullptr) == 0;
+        event.data.fd = STDIN_FILENO;
+        ready = ready && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) == 0;
+        event.data.fd = timer_fd;
+        ready = ready && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event) == 0;
+        if (!ready) {
+            cerr << "Error: unable to set up the tick timer: " << strerror(errno) << endl;
+            if (epoll_fd >= 0) {
+                close(epoll_fd);
+            }
+            if (timer_fd >= 0) {
+                close(timer_fd);
+            }
+            controller.output = &cout;
+            return false;
+        }
+
+        // Clear the screen, hide the cursor and draw the first frame
+        frame_buffer = "\x1b[2J\x1b[?25l";
+        render(game, true);
+        flush();
+
+        bool quit = false;
+        while (!quit && !game.game_over && game.has_next_block(game)) {
+            epoll_event events[2];
+            int count = epoll_wait(epoll_fd, events, 2, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            long key_time = -1;
+            for (int e = 0; e < count; ++e) {
+                if (events[e].data.fd == STDIN_FILENO) {
+                    key_time = now_ns();
+                    if (!read_keys(game, STDIN_FILENO, quit)) {
+                        quit = true; // The terminal went away
+                    }
+                } else {
+                    // Apply every tick that elapsed, so the drop rate stays fixed under load
+                    uint64_t expirations = 0;
+                    if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                        for (uint64_t k = 0; k < expirations && !game.game_over && game.has_next_block(game); ++k) {
+                            controller.apply_command(game, CMD_SOFT_DROP);
+                        }
+                    }
+                }
+            }
+
+            render(game, false);
+            flush();
+            if (key_time >= 0) {
+                latencies_ns.push_back(now_ns() - key_time);
+            }
+        }
+
+        close(epoll_fd);
+        close(timer_fd);
+
+        // Leave the cursor below the frame and show it again
+        frame_buffer = "\x1b[" + to_string(game.rows + 2) + ";1H\x1b[?25h";
+        flush();
+    }
+
+    controller.output = &cout;
+    GameEnd end = END_NO_MORE_COMMANDS;
+    if (game.game_over) {
+        end = END_GAME_OVER;
+    } else if (!game.has_next_block(game)) {
+        end = END_NO_MORE_BLOCKS;
+    }
+    controller.finish_game(game, end);
+    print_latency_report(cout);
+    return end != END_GAME_OVER;
+}
+
+bool InteractiveController::read_keys(BlockFall &game, int fd, bool &quit) {
+    ssize_t count = read(fd, key_buffer + key_count, KEY_BUFFER_BYTES - key_count);
+    if (count < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+    }
+    if (count <= 0) {
+        return false;
+    }
+    int total = key_count + (int) count;
+    int used = handle_keys(game, key_buffer, total, quit);
+    key_count = total - used;
+    memmove(key_buffer, key_buffer + used, key_count);
+    return true;
+}
+
+#else
+
+bool InteractiveController::play(BlockFall &) {
+    cerr << "Error: interactive mode is only available on Linux." << endl;
+    return false;
+}
+
+bool InteractiveController::read_keys(BlockFall &, int, bool &) {
+    return false;
+}
+
+#endif // __linux__
+
+int InteractiveController::handle_keys(BlockFall &game, const char *keys, int count, bool &quit) {
+    for (int k = 0; k < count; ++k) {
+        if (quit || game.game_over || !game.has_next_block(game)) {
+            return count; // Nothing after the end of the game is applied
+        }
+        char key = keys[k];
+        // Arrow keys arrive as ESC [ A..D, and a read can end anywhere inside one
+        if (key == '\x1b' && (k + 1 == count || (k + 2 == count && keys[k + 1] == '['))) {
+            return k;
+        }
+        if (key == '\x1b' && keys[k + 1] == '[') {
+            key = keys[k + 2];
+            k += 2;
+            key = key == 'A' ? 'w' : key == 'B' ? 's' : key == 'C' ? 'd' : key == 'D' ? 'a' : 0;
+        }
+
+        switch (key) {
+            case 'a':
+                controller.apply_command(game, CMD_MOVE_LEFT);
+                break;
+            case 'd':
+                controller.apply_command(game, CMD_MOVE_RIGHT);
+                break;
+            case 'w':
+                controller.apply_command(game, CMD_ROTATE_RIGHT);
+                break;
+            case 'z':
+                controller.apply_command(game, CMD_ROTATE_LEFT);
+                break;
+            case 's':
+                controller.apply_command(game, CMD_SOFT_DROP);
+                break;
+            case ' ':
+                controller.apply_command(game, CMD_DROP);
+                break;
+            case 'g':
+                controller.apply_command(game, CMD_GRAVITY_SWITCH);
+                break;
+            case 'q':
+            case '\x03':
+                quit = true;
+                break;
+            default:
+                break;
+        }
+    }
+    return count;
+}
+
+void InteractiveController::render(BlockFall &game, bool full_redraw) {
+    string status = "Score: " + to_string(game.current_score);
+    if (game.leaderboard.head_leaderboard_entry != nullptr) {
+        status += "  High Score: " + to_string(game.leaderboard.head_leaderboard_entry->score);
+    }
+    status += game.gravity_mode_on ? "  Gravity: on" : "  Gravity: off";
+    put_line(0, status);
+
+    int block_begin = 0;
+    int block_end = 0;
+    if (game.active_rotation != nullptr) {
+        block_begin = game.y_offset;
+        block_end = game.y_offset + game.active_rotation->shape.size();
+    }
+    if (full_redraw) {
+        render_rows(game, 0, game.rows);
+    } else {
+        // The rows the block left, the rows it is in now, and the cells the grid changed
+        render_rows(game, piece_row_begin, piece_row_end);
+        render_rows(game, block_begin, block_end);
+        if (!game.dirty_screen.empty()) {
+            render_rows(game, game.dirty_screen.row_begin, game.dirty_screen.row_end);
+        }
+    }
+    game.dirty_screen.clear();
+    piece_row_begin = block_begin;
+    piece_row_end = block_end;
+}
+
+void InteractiveController::render_rows(const BlockFall &game, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        controller.render_row(game, i, line);
+        put_line(i + 1, line);
+    }
+}
+
+void InteractiveController::put_line(int index, const string &text) {
+    if (frame[index] == text) {
+        return;
+    }
+    frame[index] = text;
+    frame_buffer += "\x1b[";
+    frame_buffer += to_string(index + 1);
+    frame_buffer += ";1H";
+    frame_buffer += text;
+    frame_buffer += "\x1b[K";
+}
+
+void InteractiveController::flush() {
+#ifdef __linux__
+    write_all(STDOUT_FILENO, frame_buffer.data(), frame_buffer.size());
+#endif
+    frame_buffer.clear();
+}
+
+void InteractiveController::print_latency_report(ostream &out) const {
+    if (latencies_ns.empty()) {
+        return;
+    }
+    vector<long> sorted = latencies_ns;
+    sort(sorted.begin(), sorted.end());
+    long total = 0;
+    for (long sample: sorted) {
+        total += sample;
+    }
+    long frame_ns = tick_ms * 1000000L;
+
+    out << "Input latency (keypress to screen, " << sorted.size() << " samples):" << endl;
+    out << "mean " << total / (long) sorted.size() / 1000 << " us, "
+        << "p50 " << sorted[sorted.size() / 2] / 1000 << " us, "
+        << "p99 " << sorted[sorted.size() * 99 / 100] / 1000 << " us, "
+        << "max " << sorted.back() / 1000 << " us" << endl;
+    out << (sorted.back() < frame_ns ? "All inputs rendered within one frame (" : "Some inputs took longer than one frame (")
+        << tick_ms << " ms)." << endl;
+}
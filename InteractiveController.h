@@ -0,0 +1,61 @@
+#ifndef PA2_INTERACTIVECONTROLLER_H
+#define PA2_INTERACTIVECONTROLLER_H
+
+#include <string>
+#include <vector>
+#include "BlockFall.h"
+#include "GameController.h"
+
+using namespace std;
+
+// Real-time terminal play (Linux only). The terminal is put in raw mode and an epoll loop waits
+// on stdin and a timerfd: every tick applies an automatic soft drop, and keys are applied as soon
+// as they arrive instead of waiting for the next tick. Only the rows under the old and new block
+// position and the rows in BlockFall::dirty_screen are rendered, and only lines that changed are
+// rewritten, so a keypress costs a few rows of output even on large grids.
+//
+// Keys: arrows or a/d move, w/up rotates right, z rotates left, s/down soft drops, space drops,
+// g switches gravity, q or Ctrl-C quits.
+class InteractiveController {
+public:
+    explicit InteractiveController(int tick_ms = 500);
+
+    int tick_ms; // Interval between automatic soft drops (one frame), must be positive
+
+    bool play(BlockFall &game); // Same return value as GameController::play. False if setup fails
+
+    // Reads the bytes available on fd and applies every key they complete. An escape sequence cut
+    // off at the end of a read is kept until the rest arrives. play() calls this for stdin.
+    // False once fd is at end of file or fails.
+    bool read_keys(BlockFall &game, int fd, bool &quit);
+
+    // Keypress-to-screen latency over the last game: count, mean, p50, p99, max
+    void print_latency_report(ostream &out) const;
+
+private:
+    static const int KEY_BUFFER_BYTES = 64;
+
+    GameController controller;
+    char key_buffer[KEY_BUFFER_BYTES]; // Bytes read but not decoded yet (a partial escape sequence)
+    int key_count = 0;
+    vector<string> frame;        // Lines currently on the screen
+    string frame_buffer;         // Escape sequences and changed lines for the next write
+    string line;                 // Scratch line for rendering
+    vector<long> latencies_ns;   // One sample per batch of keys read
+    int piece_row_begin = 0;     // Rows covered by the active block when the frame was drawn
+    int piece_row_end = 0;
+
+    // Applies the keys in keys[0, count) and returns how many bytes were used: all of them, or up
+    // to an escape sequence that is not complete yet
+    int handle_keys(BlockFall &game, const char *keys, int count, bool &quit);
+
+    void render(BlockFall &game, bool full_redraw); // Clears game.dirty_screen
+
+    void render_rows(const BlockFall &game, int begin, int end);
+
+    void put_line(int index, const string &text);
+
+    void flush();
+};
+
+#endif //PA2_INTERACTIVECONTROLLER_H
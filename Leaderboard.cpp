@@ -12,10 +12,24 @@ void Leaderboard::read_from_file(const string& filename) {
     string playerName;
     time_t date;
     unsigned long score;
+    vector<HistoryResult> loaded; // Added to the history in one go
     while (file >> score >> date >> playerName) {
-        LeaderboardEntry* newEntry = new LeaderboardEntry(score, date, playerName);
-        insert_new_entry(newEntry);
+        // Every row goes into the history under its player's name id. A row that would land past
+        // the last place of a full list takes no entry
+        int entryCount = 0;
+        LeaderboardEntry* last = head_leaderboard_entry;
+        for (LeaderboardEntry* entry = head_leaderboard_entry; entry != nullptr; entry = entry->next_leaderboard_entry) {
+            last = entry;
+            ++entryCount;
+        }
+        uint32_t id = intern(playerName);
+        loaded.push_back(HistoryResult{score, date, id});
+        if (entryCount >= MAX_LEADERBOARD_SIZE && score <= last->score) {
+            continue;
+        }
+        insert_into_list(create_entry(score, date, playerName));
     }
+    history.add_all(loaded);
 
     file.close();
 }
@@ -29,29 +43,34 @@ void Leaderboard::write_to_file(const string& filename) {
 
     LeaderboardEntry* currentEntry = head_leaderboard_entry;
     while (currentEntry != nullptr) {
-        file << currentEntry->score << " " << currentEntry->last_played << " " << currentEntry->player_name << endl;
+        file << currentEntry->score << " " << currentEntry->last_played << " " << player_name(currentEntry) << endl;
         currentEntry = currentEntry->next_leaderboard_entry;
     }
 
     file.close();
 }
 
-void Leaderboard::print_leaderboard() {
-    cout << "Leaderboard:" << endl;
-    cout << "-----------" << endl;
+void Leaderboard::print_leaderboard(ostream &out) {
+    out << "Leaderboard:" << endl;
+    out << "-----------" << endl;
 
     int rank = 1;
     LeaderboardEntry* temp = head_leaderboard_entry;
 
     while (temp != nullptr) {
-        cout << rank << ". " << temp->player_name << " " << temp->score << " ";
-
-        // Format the last_played time
-        struct tm* timeInfo;
+        out << rank << ". " << player_name(temp) << " " << temp->score << " ";
+
+        // Format the last_played time. Games finish on several threads at once (tournaments, the
+        // host), so the reentrant form is used instead of localtime's shared buffer
+        struct tm timeInfo;
+#ifdef _WIN32
+        localtime_s(&timeInfo, &temp->last_played);
+#else
+        localtime_r(&temp->last_played, &timeInfo);
+#endif
         char buffer[80]; // For storing the formatted time
-        timeInfo = localtime(&temp->last_played);
-        strftime(buffer, sizeof(buffer), "%H:%M:%S/%d.%m.%Y", timeInfo);
-        cout << buffer << endl;
+        strftime(buffer, sizeof(buffer), "%H:%M:%S/%d.%m.%Y", &timeInfo);
+        out << buffer << endl;
 
         temp = temp->next_leaderboard_entry;
         rank++;
@@ -59,6 +78,11 @@ void Leaderboard::print_leaderboard() {
 }
 
 void Leaderboard::insert_new_entry(LeaderboardEntry* new_entry) {
+    history.add(new_entry->score, new_entry->last_played, new_entry->player_id);
+    insert_into_list(new_entry);
+}
+
+void Leaderboard::insert_into_list(LeaderboardEntry* new_entry) {
     if (head_leaderboard_entry == nullptr) {
         head_leaderboard_entry = new_entry;
         return;
@@ -100,19 +124,73 @@ void Leaderboard::insert_new_entry(LeaderboardEntry* new_entry) {
         while (nextEntry != nullptr) {
             LeaderboardEntry* toDelete = nextEntry;
             nextEntry = nextEntry->next_leaderboard_entry;
-            delete toDelete;
+            release_entry(toDelete);
         }
     }
 }
 
 
-Leaderboard::~Leaderboard() {
-    LeaderboardEntry* currentEntry = head_leaderboard_entry;
-    while (currentEntry != nullptr) {
-        LeaderboardEntry* temp = currentEntry;
-        currentEntry = currentEntry->next_leaderboard_entry;
-        delete temp;
+LeaderboardEntry* Leaderboard::create_entry(unsigned long score, time_t last_played, const string& player_name) {
+    if (free_entries == nullptr) {
+        add_slab();
+    }
+    LeaderboardEntry* entry = free_entries;
+    free_entries = entry->next_leaderboard_entry;
+    *entry = LeaderboardEntry(score, last_played, intern(player_name));
+    return entry;
+}
+
+void Leaderboard::add_slab() {
+    slabs.push_back(unique_ptr<LeaderboardEntry[]>(new LeaderboardEntry[LEADERBOARD_SLAB_ENTRIES]));
+    LeaderboardEntry* slab = slabs.back().get();
+    for (int i = LEADERBOARD_SLAB_ENTRIES - 1; i >= 0; --i) {
+        slab[i].next_leaderboard_entry = free_entries;
+        free_entries = &slab[i];
+    }
+}
+
+void Leaderboard::reserve_entries(int count) {
+    int available = 0;
+    for (LeaderboardEntry* entry = free_entries; entry != nullptr && available < count; entry = entry->next_leaderboard_entry) {
+        ++available;
     }
+    for (; available < count; available += LEADERBOARD_SLAB_ENTRIES) {
+        add_slab();
+    }
+}
+
+void Leaderboard::clear() {
+    while (head_leaderboard_entry != nullptr) {
+        LeaderboardEntry* entry = head_leaderboard_entry;
+        head_leaderboard_entry = entry->next_leaderboard_entry;
+        release_entry(entry);
+    }
+    history.clear();
+}
+
+void Leaderboard::release_entry(LeaderboardEntry* entry) {
+    entry->next_leaderboard_entry = free_entries;
+    free_entries = entry;
+}
+
+uint32_t Leaderboard::intern(const string& player_name) {
+    auto found = name_ids.find(player_name);
+    if (found != name_ids.end()) {
+        return found->second;
+    }
+    uint32_t id = names.size();
+    names.push_back(player_name);
+    name_ids.emplace(player_name, id);
+    return id;
+}
+
+int Leaderboard::find_player(const string& player_name) const {
+    auto found = name_ids.find(player_name);
+    return found == name_ids.end() ? -1 : (int) found->second;
+}
+
+Leaderboard::~Leaderboard() {
+    // Entries live in the slabs, which are released with the leaderboard
 }
 
 
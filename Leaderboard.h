@@ -2,21 +2,64 @@
 #define PA2_LEADERBOARD_H
 
 #include <ctime>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "LeaderboardEntry.h"
+#include "LeaderboardHistory.h"
 
 #define MAX_LEADERBOARD_SIZE 10
 
+// Entries are carved out of slabs of this many records
+#define LEADERBOARD_SLAB_ENTRIES 64
+
 using namespace std;
 
 class Leaderboard {
 public:
+    Leaderboard() = default;
+    Leaderboard(const Leaderboard &) = delete;
+    Leaderboard &operator=(const Leaderboard &) = delete;
+
     LeaderboardEntry* head_leaderboard_entry = nullptr;
     void read_from_file(const string &filename);
     void write_to_file(const string &filename);
-    void print_leaderboard();
-    void insert_new_entry(LeaderboardEntry *new_entry);
+    void print_leaderboard(ostream &out = cout);
+    void insert_new_entry(LeaderboardEntry *new_entry); // Takes entries from create_entry only
     virtual ~Leaderboard();
+
+    // Takes an entry from the pool (a new slab only when the free list is empty) and interns the name
+    LeaderboardEntry *create_entry(unsigned long score, time_t last_played, const string &player_name);
+
+    void release_entry(LeaderboardEntry *entry); // Returns an entry that is not in the list to the pool
+
+    void reserve_entries(int count); // Makes sure the next count create_entry calls take no new slab
+
+    void clear(); // Empties the list (entries go back to the pool) and the history; names keep their ids
+
+    uint32_t intern(const string &player_name);
+
+    void insert_into_list(LeaderboardEntry *new_entry); // insert_new_entry without the history
+
+    const string &player_name(const LeaderboardEntry *entry) const {
+        return names[entry->player_id];
+    }
+
+    int find_player(const string &player_name) const; // Name table id, or -1 for an unknown player
+
+    // Every result read or inserted by this process, including those that fell off the top list.
+    // Not saved: write_to_file keeps only the top list
+    LeaderboardHistory history;
+
+private:
+    vector<unique_ptr<LeaderboardEntry[]>> slabs;
+    LeaderboardEntry *free_entries = nullptr;
+    vector<string> names;                 // Player names by id
+    unordered_map<string, uint32_t> name_ids;
+
+    void add_slab(); // Chains a fresh slab onto the free list
 };
 
 
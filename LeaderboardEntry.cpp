@@ -2,9 +2,7 @@
 
 LeaderboardEntry::LeaderboardEntry(unsigned long score,
                                    time_t lastPlayed,
-                                   const string &playerName) :
+                                   uint32_t playerId) :
                                    score(score),
                                    last_played(lastPlayed),
-                                   player_name(playerName) {}
-
-
+                                   player_id(playerId) {}
@@ -1,20 +1,24 @@
 #ifndef PA2_LEADERBOARDENTRY_H
 #define PA2_LEADERBOARDENTRY_H
 
+#include <cstdint>
 #include <ctime>
 #include <string>
 
 using namespace std;
 
+// Fixed-size record. Entries are handed out by Leaderboard::create_entry from the leaderboard's
+// entry pool, and the player name lives in the leaderboard's name table (see player_name()).
 class LeaderboardEntry {
 public:
-    LeaderboardEntry(unsigned long score, time_t lastPlayed, const string &playerName);
+    LeaderboardEntry() = default;
+    LeaderboardEntry(unsigned long score, time_t lastPlayed, uint32_t playerId);
 
 public:
-    unsigned long score;
-    time_t last_played;
-    string player_name;
-    LeaderboardEntry * next_leaderboard_entry = nullptr;
+    unsigned long score = 0;
+    time_t last_played = 0;
+    LeaderboardEntry * next_leaderboard_entry = nullptr; // Next lower score, or next free entry in the pool
+    uint32_t player_id = 0; // Index into the owning leaderboard's name table
 };
 
 #endif //PA2_LEADERBOARDENTRY_H
@@ -0,0 +1,81 @@
+#include "LeaderboardHistory.h"
+
+void LeaderboardHistory::add(unsigned long score, time_t last_played, uint32_t player_id) {
+    HistoryResult result{score, last_played, player_id};
+    if (player_id >= players.size()) {
+        players.resize(player_id + 1);
+    }
+    PlayerStats &stats = players[player_id];
+    stats.best_score = stats.games == 0 ? score : max(stats.best_score, score);
+    stats.games++;
+    stats.results.insert(result);
+    by_time.insert(result);
+    by_score.insert(result);
+}
+
+void LeaderboardHistory::add_all(const vector<HistoryResult> &results) {
+    vector<vector<HistoryResult>> per_player;
+    for (const HistoryResult &result: results) {
+        if (result.player_id >= players.size()) {
+            players.resize(result.player_id + 1);
+        }
+        if (result.player_id >= per_player.size()) {
+            per_player.resize(result.player_id + 1);
+        }
+        PlayerStats &stats = players[result.player_id];
+        stats.best_score = stats.games == 0 ? result.score : max(stats.best_score, result.score);
+        stats.games++;
+        per_player[result.player_id].push_back(result);
+    }
+    for (size_t p = 0; p < per_player.size(); ++p) {
+        if (!per_player[p].empty()) {
+            players[p].results.insert_all(per_player[p]);
+        }
+    }
+    by_time.insert_all(results);
+    by_score.insert_all(results);
+}
+
+void LeaderboardHistory::clear() {
+    players.clear();
+    by_time = SortedBlocks<HistoryResult, TimeOf>();
+    by_score = SortedBlocks<HistoryResult, ScoreOf>();
+}
+
+size_t LeaderboardHistory::size() const {
+    return by_score.size();
+}
+
+const PlayerStats *LeaderboardHistory::player(uint32_t player_id) const {
+    if (player_id >= players.size() || players[player_id].games == 0) {
+        return nullptr;
+    }
+    return &players[player_id];
+}
+
+size_t LeaderboardHistory::count_below(unsigned long score) const {
+    return by_score.count_below(score);
+}
+
+double LeaderboardHistory::percentile(unsigned long score) const {
+    if (size() == 0) {
+        return 0;
+    }
+    return 100.0 * count_below(score) / size();
+}
+
+void LeaderboardHistory::results_between(time_t from, time_t to, vector<HistoryResult> &out) const {
+    by_time.for_each_between(from, to, [&out](const HistoryResult &result) {
+        out.push_back(result);
+    });
+}
+
+void LeaderboardHistory::results_between(uint32_t player_id, time_t from, time_t to, vector<HistoryResult> &out) const {
+    const PlayerStats *stats = player(player_id);
+    if (stats == nullptr) {
+        return;
+    }
+    stats->results.for_each_between(from, to, [&out](const HistoryResult &result) {
+        out.push_back(result);
+    });
+}
@@ -0,0 +1,198 @@
+#ifndef PA2_LEADERBOARDHISTORY_H
+#define PA2_LEADERBOARDHISTORY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+using namespace std;
+
+// Smallest target block size of SortedBlocks. Past HISTORY_BLOCK_ENTRIES squared elements the
+// target is sqrt(n). Blocks split at twice the target.
+#define HISTORY_BLOCK_ENTRIES 256
+
+// Sorted sequence kept as a list of sorted blocks (square-root decomposition). Blocks hold about
+// sqrt(n) elements and are re-split whenever their count grows past twice that, so there are
+// O(sqrt n) blocks. Inserting costs a binary search over the blocks plus a shift inside one block,
+// and ranking a key sums block sizes up to its block, so neither touches more than O(sqrt n)
+// elements even when values arrive out of order. Equal keys keep their insertion order.
+template <typename T, typename Key>
+class SortedBlocks {
+public:
+    size_t size() const {
+        return count;
+    }
+
+    void insert(const T &value) {
+        ++count;
+        if (blocks.empty()) {
+            blocks.push_back(vector<T>(1, value));
+            return;
+        }
+        // First block whose last element sorts after value, or the last block
+        size_t b = block_after(Key()(value));
+        if (b == blocks.size()) {
+            b--;
+        }
+        vector<T> &block = blocks[b];
+        block.insert(upper_bound(block.begin(), block.end(), value, less_than), value);
+        size_t target = block_target();
+        if (block.size() > 2 * target) {
+            vector<T> upper(block.begin() + target, block.end());
+            block.resize(target);
+            blocks.insert(blocks.begin() + b + 1, std::move(upper));
+            if (blocks.size() > 2 * target) {
+                // Splits made at a smaller target; about sqrt(n) inserts per block since the last
+                // re-split, so this stays amortized O(1)
+                vector<T> all;
+                all.reserve(count);
+                for (const vector<T> &old: blocks) {
+                    all.insert(all.end(), old.begin(), old.end());
+                }
+                split(all);
+            }
+        }
+    }
+
+    // Bulk insert: one stable sort and re-split instead of a block shift per element
+    void insert_all(const vector<T> &values) {
+        vector<T> all;
+        all.reserve(count + values.size());
+        for (const vector<T> &block: blocks) {
+            all.insert(all.end(), block.begin(), block.end());
+        }
+        all.insert(all.end(), values.begin(), values.end());
+        stable_sort(all.begin(), all.end(), less_than);
+        split(all);
+    }
+
+    // Number of elements whose key is below key
+    template <typename K>
+    size_t count_below(const K &key) const {
+        size_t below = 0;
+        for (const vector<T> &block: blocks) {
+            if (Key()(block.back()) < key) {
+                below += block.size();
+                continue;
+            }
+            return below + (lower_bound(block.begin(), block.end(), key, key_below<K>) - block.begin());
+        }
+        return below;
+    }
+
+    // Calls fn on every element with a key in [from, to), in order
+    template <typename K, typename Fn>
+    void for_each_between(const K &from, const K &to, Fn fn) const {
+        for (size_t b = block_at_or_after(from); b < blocks.size(); ++b) {
+            const vector<T> &block = blocks[b];
+            for (auto it = lower_bound(block.begin(), block.end(), from, key_below<K>); it != block.end(); ++it) {
+                if (!(Key()(*it) < to)) {
+                    return;
+                }
+                fn(*it);
+            }
+        }
+    }
+
+private:
+    vector<vector<T>> blocks;
+    size_t count = 0;
+
+    size_t block_target() const {
+        return max((size_t) HISTORY_BLOCK_ENTRIES, (size_t) sqrt((double) count));
+    }
+
+    // Replaces the blocks with all (already sorted) cut into blocks of the target size
+    void split(const vector<T> &all) {
+        count = all.size();
+        size_t target = block_target();
+        blocks.clear();
+        for (size_t i = 0; i < all.size(); i += target) {
+            blocks.push_back(vector<T>(all.begin() + i, all.begin() + min(all.size(), i + target)));
+        }
+    }
+
+    static bool less_than(const T &a, const T &b) {
+        return Key()(a) < Key()(b);
+    }
+
+    template <typename K>
+    static bool key_below(const T &a, const K &key) {
+        return Key()(a) < key;
+    }
+
+    template <typename K>
+    size_t block_after(const K &key) const {
+        return partition_point(blocks.begin(), blocks.end(), [&key](const vector<T> &block) {
+            return !(key < Key()(block.back()));
+        }) - blocks.begin();
+    }
+
+    template <typename K>
+    size_t block_at_or_after(const K &key) const {
+        return partition_point(blocks.begin(), blocks.end(), [&key](const vector<T> &block) {
+            return Key()(block.back()) < key;
+        }) - blocks.begin();
+    }
+};
+
+// One finished game in the history
+struct HistoryResult {
+    unsigned long score;
+    time_t last_played;
+    uint32_t player_id; // Leaderboard name table id
+};
+
+struct ScoreOf {
+    unsigned long operator()(const HistoryResult &result) const {
+        return result.score;
+    }
+};
+
+struct TimeOf {
+    time_t operator()(const HistoryResult &result) const {
+        return result.last_played;
+    }
+};
+
+struct PlayerStats {
+    unsigned long best_score = 0;
+    unsigned long games = 0;
+    SortedBlocks<HistoryResult, TimeOf> results; // This player's results by last_played
+};
+
+// Every result a leaderboard has seen, not just the top MAX_LEADERBOARD_SIZE, with indexes kept
+// up to date on every add: per player (dense by name id), by time and by score. The history lives
+// only as long as the process: the leaderboard file keeps the top list, so a later run starts from
+// those rows.
+class LeaderboardHistory {
+public:
+    void add(unsigned long score, time_t last_played, uint32_t player_id);
+
+    void add_all(const vector<HistoryResult> &results); // Same as add for each, for bulk loads
+
+    size_t size() const;
+
+    void clear();
+
+    const PlayerStats *player(uint32_t player_id) const; // nullptr if the player has no results
+
+    size_t count_below(unsigned long score) const; // Results with a lower score
+
+    double percentile(unsigned long score) const;  // Share of results below score, 0 to 100
+
+    // Results with last_played in [from, to), oldest first
+    void results_between(time_t from, time_t to, vector<HistoryResult> &out) const;
+
+    void results_between(uint32_t player_id, time_t from, time_t to, vector<HistoryResult> &out) const;
+
+private:
+    vector<PlayerStats> players; // By player id
+    SortedBlocks<HistoryResult, TimeOf> by_time;
+    SortedBlocks<HistoryResult, ScoreOf> by_score;
+};
+
+#endif //PA2_LEADERBOARDHISTORY_H
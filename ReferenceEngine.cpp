@@ -0,0 +1,262 @@
+#include "ReferenceEngine.h"
+#include "GameSetup.h"
+
+ReferenceEngine::ReferenceEngine(const vector<vector<int>> &grid, const vector<vector<vector<bool>>> &shapes,
+                                 bool gravity_mode_on)
+        : rows(grid.size()), cols(grid[0].size()), grid(grid), gravity_mode_on(gravity_mode_on) {
+    for (size_t b = 0; b + 1 < shapes.size(); ++b) {
+        vector<vector<vector<bool>>> block_rotations(1, shapes[b]);
+        for (int r = 1; r < 4; ++r) {
+            block_rotations.push_back(GameSetup::rotate_block(block_rotations.back()));
+        }
+        rotations.push_back(block_rotations);
+    }
+    power_up = shapes.back();
+}
+
+bool ReferenceEngine::has_block() const {
+    return block < (int) rotations.size();
+}
+
+const vector<vector<bool>> &ReferenceEngine::shape() const {
+    return rotations[block][rotation];
+}
+
+void ReferenceEngine::apply(GameCommand command) {
+    switch (command) {
+        case CMD_ROTATE_RIGHT:
+            rotate(true);
+            break;
+        case CMD_ROTATE_LEFT:
+            rotate(false);
+            break;
+        case CMD_MOVE_RIGHT:
+            move(1);
+            break;
+        case CMD_MOVE_LEFT:
+            move(-1);
+            break;
+        case CMD_DROP:
+            drop_block();
+            break;
+        case CMD_SOFT_DROP:
+            soft_drop();
+            break;
+        case CMD_GRAVITY_SWITCH:
+            gravity_mode_on = !gravity_mode_on;
+            toggle_gravity();
+            break;
+        default:
+            // PRINT_GRID changes nothing
+            break;
+    }
+}
+
+bool ReferenceEngine::is_collision(int dx, int dy) const {
+    const vector<vector<bool>> &active = shape();
+    int new_x = x_offset + dx;
+    int new_y = y_offset + dy;
+
+    for (int i = 0; i < (int) active.size(); i++) {
+        for (int j = 0; j < (int) active[0].size(); j++) {
+            // Check block boundaries
+            if (new_x + j < 0 || new_x + j >= cols || new_y + i >= rows) {
+                return true;
+            }
+
+            // Check the cell of the grid with the cell of the active block
+            if (active[i][j] == 1 && grid[new_y + i][new_x + j] != 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ReferenceEngine::is_valid_position(int dx, int dy) const {
+    const vector<vector<bool>> &active = shape();
+    int new_x = x_offset + dx;
+    int new_y = y_offset + dy;
+
+    if (new_x < 0 || new_x + (int) active[0].size() > cols || new_y + (int) active.size() > rows) {
+        return false;
+    }
+
+    for (int i = 0; i < (int) active.size(); ++i) {
+        for (int j = 0; j < (int) active[0].size(); ++j) {
+            if (active[i][j] == 1 && grid[new_y + i][new_x + j] != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ReferenceEngine::rotate(bool clockwise) {
+    int original_rotation = rotation;
+    rotation = (rotation + (clockwise ? 1 : 3)) % 4;
+    if (is_collision(0, 0) || !is_valid_position(0, 0)) {
+        rotation = original_rotation;
+    }
+}
+
+void ReferenceEngine::move(int dx) {
+    x_offset += dx;
+    if (is_collision(0, 0) || !is_valid_position(0, 0)) {
+        x_offset -= dx;
+    }
+}
+
+void ReferenceEngine::drop_block() {
+    // Move the block down until a collision is detected
+    while (!is_collision(0, 1) && is_valid_position(0, 1)) {
+        y_offset++;
+    }
+
+    int numberof1 = 0;
+    for (const vector<bool> &row: shape()) {
+        for (bool cell: row) {
+            numberof1 += cell;
+        }
+    }
+    current_score += y_offset * numberof1;
+
+    update_grid();
+    check_power_ups();
+
+    if (!gravity_mode_on) {
+        if (check_completed_rows() > 0) {
+            remove_completed_rows();
+        }
+    }
+
+    block++;
+    rotation = 0;
+    x_offset = 0;
+    y_offset = 0;
+    if (has_block() && (is_collision(0, 0) || !is_valid_position(0, 0))) {
+        game_over = true;
+    }
+}
+
+void ReferenceEngine::soft_drop() {
+    if (!is_collision(0, 1) && is_valid_position(0, 1)) {
+        y_offset++;
+    } else {
+        drop_block();
+    }
+}
+
+void ReferenceEngine::update_grid() {
+    const vector<vector<bool>> &active = shape();
+    for (int i = 0; i < (int) active.size(); ++i) {
+        for (int j = 0; j < (int) active[0].size(); ++j) {
+            if (active[i][j] == 1) {
+                grid[y_offset + i][x_offset + j] = 1;
+            }
+        }
+    }
+
+    toggle_gravity();
+}
+
+int ReferenceEngine::check_completed_rows() {
+    int completed_rows = 0;
+    for (int i = 0; i < rows; ++i) {
+        bool is_row_full = true;
+        for (int j = 0; j < cols; ++j) {
+            if (grid[i][j] == 0) {
+                is_row_full = false;
+                break;
+            }
+        }
+        if (is_row_full) {
+            completed_rows++;
+        }
+    }
+
+    current_score += completed_rows * cols;
+    return completed_rows;
+}
+
+void ReferenceEngine::remove_completed_rows() {
+    for (int i = 0; i < rows; ++i) {
+        bool is_row_full = true;
+        for (int j = 0; j < cols; ++j) {
+            if (grid[i][j] == 0) {
+                is_row_full = false;
+                break;
+            }
+        }
+
+        // Clear the row, then shift the rows above it down (row 0 keeps its old contents)
+        if (is_row_full) {
+            for (int j = 0; j < cols; ++j) {
+                grid[i][j] = 0;
+            }
+            for (int k = i; k > 0; --k) {
+                for (int j = 0; j < cols; ++j) {
+                    grid[k][j] = grid[k - 1][j];
+                }
+            }
+        }
+    }
+}
+
+void ReferenceEngine::check_power_ups() {
+    if (!find_matrix()) {
+        return;
+    }
+
+    int numberOfOne = 0;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            if (grid[i][j] == 1) {
+                grid[i][j] = 0;
+                numberOfOne++;
+            }
+        }
+    }
+    current_score += 1000;
+    current_score += numberOfOne;
+}
+
+bool ReferenceEngine::find_matrix() const {
+    for (size_t i = 0; i + power_up.size() <= grid.size(); ++i) {
+        for (size_t j = 0; j + power_up[0].size() <= grid[i].size(); ++j) {
+            bool found = true;
+            for (size_t k = 0; k < power_up.size() && found; ++k) {
+                for (size_t l = 0; l < power_up[k].size(); ++l) {
+                    if (grid[i + k][j + l] != power_up[k][l]) {
+                        found = false;
+                        break;
+                    }
+                }
+            }
+            if (found) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ReferenceEngine::toggle_gravity() {
+    if (gravity_mode_on) {
+        // One downward sweep per row, enough for any cell to reach the bottom
+        for (int number = 0; number < rows; ++number) {
+            for (int i = 0; i < rows - 1; ++i) {
+                for (int j = 0; j < cols; ++j) {
+                    if (grid[i][j] == 1 && grid[i + 1][j] == 0) {
+                        grid[i][j] = 0;
+                        grid[i + 1][j] = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (check_completed_rows() > 0) {
+        remove_completed_rows();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef PA2_REFERENCEENGINE_H
+#define PA2_REFERENCEENGINE_H
+
+#include <vector>
+#include "GameController.h"
+
+using namespace std;
+
+// The game rules exactly as first written: a vector<vector<int>> grid, full scans after every
+// placement, the row-by-row gravity sweep and the plain power-up search. Nothing here is meant to
+// be fast; it is the executable spec the optimized GameController is checked against.
+class ReferenceEngine {
+public:
+    // shapes are in blocks file order: the last one is the power-up
+    ReferenceEngine(const vector<vector<int>> &grid, const vector<vector<vector<bool>>> &shapes, bool gravity_mode_on);
+
+    int rows;
+    int cols;
+    vector<vector<int>> grid;
+    vector<vector<vector<vector<bool>>>> rotations; // rotations[block][0..3], clockwise
+    vector<vector<bool>> power_up;
+
+    int block = 0;          // Index of the active block, rotations.size() once every block is placed
+    int rotation = 0;       // Rotation index of the active block (0 to 3)
+    int x_offset = 0;
+    int y_offset = 0;
+    bool gravity_mode_on;
+    unsigned long current_score = 0;
+    bool game_over = false;
+
+    bool has_block() const;
+
+    const vector<vector<bool>> &shape() const; // Shape of the active rotation
+
+    void apply(GameCommand command);
+
+private:
+    bool is_collision(int dx, int dy) const;
+
+    bool is_valid_position(int dx, int dy) const;
+
+    void rotate(bool clockwise);
+
+    void move(int dx);
+
+    void drop_block();
+
+    void soft_drop();
+
+    void update_grid();
+
+    int check_completed_rows();
+
+    void remove_completed_rows();
+
+    void check_power_ups();
+
+    bool find_matrix() const;
+
+    void toggle_gravity();
+};
+
+#endif //PA2_REFERENCEENGINE_H
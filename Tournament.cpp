@@ -0,0 +1,86 @@
+#include <atomic>
+#include "Tournament.h"
+#include "WorkerPool.h"
+
+Tournament::Tournament(shared_ptr<const GameSetup> setup, bool gravity_mode_on, int worker_count)
+        : setup(setup), gravity_mode_on(gravity_mode_on), worker_count(worker_count < 1 ? 1 : worker_count) {}
+
+static string player_name_of(const string &commands_file) {
+    size_t begin = commands_file.find_last_of('/');
+    begin = begin == string::npos ? 0 : begin + 1;
+    size_t end = commands_file.find_last_of('.');
+    if (end == string::npos || end < begin) {
+        end = commands_file.size();
+    }
+    return commands_file.substr(begin, end - begin);
+}
+
+void Tournament::run(const vector<string> &commands_files, const string &leaderboard_file_name) {
+    results.assign(commands_files.size(), TournamentResult());
+    for (size_t i = 0; i < commands_files.size(); ++i) {
+        results[i].commands_file = commands_files[i];
+        results[i].player_name = player_name_of(commands_files[i]);
+    }
+
+    // Workers pull the next file as they finish, so long and short files balance out
+    atomic<size_t> next(0);
+    {
+        WorkerPool pool(worker_count);
+        for (int w = 0; w < pool.size(); ++w) {
+            pool.submit(w, [this, &next]() {
+                size_t i;
+                while ((i = next++) < results.size()) {
+                    play_one(results[i]);
+                }
+            });
+        }
+    } // The pool joins here, after every run has finished
+
+    if (!leaderboard_file_name.empty()) {
+        // The file already holds what an earlier run() merged, so start over from it
+        leaderboard.clear();
+        leaderboard.read_from_file(leaderboard_file_name);
+    }
+    for (const TournamentResult &result: results) {
+        if (result.played) {
+            leaderboard.insert_new_entry(leaderboard.create_entry(result.score, result.finished, result.player_name));
+        }
+    }
+    if (!leaderboard_file_name.empty()) {
+        leaderboard.write_to_file(leaderboard_file_name);
+    }
+}
+
+void Tournament::play_one(TournamentResult &result) const {
+    BlockFall game(setup, gravity_mode_on, "", result.player_name);
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+
+    result.played = controller.play(game, result.commands_file) || game.game_over;
+    if (game.game_over) {
+        result.end = END_GAME_OVER;
+    } else if (!game.has_next_block(game)) {
+        result.end = END_NO_MORE_BLOCKS;
+    }
+    result.score = game.current_score;
+    result.finished = time(nullptr);
+}
+
+void Tournament::print_results(ostream &out) const {
+    for (const TournamentResult &result: results) {
+        out << result.player_name << " ";
+        if (!result.played) {
+            out << "could not be played" << endl;
+            continue;
+        }
+        out << result.score << " ";
+        if (result.end == END_GAME_OVER) {
+            out << "GAME OVER" << endl;
+        } else if (result.end == END_NO_MORE_BLOCKS) {
+            out << "YOU WIN" << endl;
+        } else {
+            out << "GAME FINISHED" << endl;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef PA2_TOURNAMENT_H
+#define PA2_TOURNAMENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BlockFall.h"
+#include "GameController.h"
+#include "GameSetup.h"
+#include "Leaderboard.h"
+
+using namespace std;
+
+struct TournamentResult {
+    string commands_file;
+    string player_name;        // Commands file name without directory and extension
+    bool played = false;       // False if the commands file could not be opened
+    GameEnd end = END_NO_MORE_COMMANDS;
+    unsigned long score = 0;
+    time_t finished = 0;
+};
+
+// Plays many command files against one parsed setup. Every run starts from its own BlockFall
+// built on the shared setup (only the grid is copied), runs silently on a worker thread, and
+// records its score in its own empty leaderboard. The real leaderboard file is read once and
+// written once, after all runs have been merged into it.
+class Tournament {
+public:
+    Tournament(shared_ptr<const GameSetup> setup, bool gravity_mode_on, int worker_count);
+
+    vector<TournamentResult> results; // One per command file, in the order given to run()
+    Leaderboard leaderboard;          // Leaderboard file contents plus every run after run()
+
+    // With a leaderboard file, the leaderboard is rebuilt from the file before the runs are merged,
+    // so calling run() again gives what playing the files one after another would. An empty
+    // leaderboard_file_name merges into the in-memory leaderboard only, adding to earlier runs
+    void run(const vector<string> &commands_files, const string &leaderboard_file_name);
+
+    void print_results(ostream &out) const;
+
+private:
+    shared_ptr<const GameSetup> setup;
+    bool gravity_mode_on;
+    int worker_count;
+
+    void play_one(TournamentResult &result) const;
+};
+
+#endif //PA2_TOURNAMENT_H
@@ -0,0 +1,238 @@
+#include <cstring>
+#include <iostream>
+#include "GridKernels.h"
+#include "TraceWriter.h"
+
+// Buffered bytes are handed to the file (or gzip stream) in chunks of about this size
+#define TRACE_BUFFER_BYTES (64 * 1024)
+
+TraceWriter::TraceWriter(const string &file_name, bool compress, int keyframe_interval)
+        : keyframe_interval(keyframe_interval < 1 ? 1 : keyframe_interval) {
+    if (compress) {
+#ifdef BLOCKFALL_TRACE_ZLIB
+        gz = gzopen(file_name.c_str(), "wb6");
+        if (gz == nullptr) {
+            cerr << "Unable to open file: " << file_name << endl;
+        }
+        buffer.reserve(TRACE_BUFFER_BYTES + 1024);
+        return;
+#else
+        cerr << "Trace compression needs BLOCKFALL_TRACE_ZLIB, writing " << file_name << " uncompressed." << endl;
+#endif
+    }
+    file = fopen(file_name.c_str(), "wb");
+    if (file == nullptr) {
+        cerr << "Unable to open file: " << file_name << endl;
+    }
+    buffer.reserve(TRACE_BUFFER_BYTES + 1024);
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+    if (file != nullptr) {
+        fclose(file);
+    }
+#ifdef BLOCKFALL_TRACE_ZLIB
+    if (gz != nullptr) {
+        gzclose(gz);
+    }
+#endif
+}
+
+bool TraceWriter::is_open() const {
+#ifdef BLOCKFALL_TRACE_ZLIB
+    if (gz != nullptr) {
+        return true;
+    }
+#endif
+    return file != nullptr;
+}
+
+void TraceWriter::flush() {
+    if (buffer.empty()) {
+        return;
+    }
+    if (file != nullptr) {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+#ifdef BLOCKFALL_TRACE_ZLIB
+    if (gz != nullptr) {
+        gzwrite(gz, buffer.data(), buffer.size());
+    }
+#endif
+    buffer.clear();
+}
+
+void TraceWriter::put_u8(uint8_t value) {
+    buffer.push_back(value);
+}
+
+void TraceWriter::put_u16(uint16_t value) {
+    put_u8(value);
+    put_u8(value >> 8);
+}
+
+void TraceWriter::put_u32(uint32_t value) {
+    put_u16(value);
+    put_u16(value >> 16);
+}
+
+void TraceWriter::put_u64(uint64_t value) {
+    put_u32(value);
+    put_u32(value >> 32);
+}
+
+void TraceWriter::put_bits(const Grid &grid, int row, int col_begin, int col_end) {
+    uint8_t byte = 0;
+    int bit = 0;
+    for (int c = col_begin; c < col_end; ++c) {
+        byte |= (grid.get(row, c) != 0) << bit;
+        if (++bit == 8) {
+            put_u8(byte);
+            byte = 0;
+            bit = 0;
+        }
+    }
+    if (bit != 0) {
+        put_u8(byte);
+    }
+}
+
+void TraceWriter::begin_game(const BlockFall &game) {
+    started = true;
+    buffer.insert(buffer.end(), {'B', 'F', 'T', 'R'});
+    put_u16(1);
+    put_u16(game.gravity_mode_on ? 1 : 0);
+    put_u32(game.rows);
+    put_u32(game.cols);
+    put_u32(keyframe_interval);
+    last_score = game.current_score;
+    put_u8(TRACE_SCORE);
+    put_u64(last_score);
+    keyframe(game);
+    // Rows that were never occupied are empty in a fresh shadow already
+    shadow = Grid(game.rows, game.cols);
+    sync_shadow(game.grid, 0, game.rows);
+}
+
+void TraceWriter::placement(const BlockFall &game) {
+    put_u8(TRACE_PLACEMENT);
+    put_u32(placements++);
+    put_u32(game.x_offset);
+    put_u32(game.y_offset);
+    put_u8(game.active_rotation_index);
+    ++placements_since_keyframe;
+}
+
+void TraceWriter::rows_cleared(const BlockFall &game) {
+    // Only rows changed since the last check can be full, so the scan stays inside that range
+    changed_rows.clear();
+    game.grid.for_each_occupied_row(game.dirty_rows.row_begin, game.dirty_rows.row_end, [&](int r) {
+        if (GridKernels::row_is_full(game.grid.row(r), game.cols)) {
+            changed_rows.push_back(r);
+        }
+    });
+    put_u8(TRACE_ROWS_CLEARED);
+    put_u32(changed_rows.size());
+    for (int r: changed_rows) {
+        put_u32(r);
+    }
+}
+
+void TraceWriter::gravity(int col_begin, int col_end) {
+    put_u8(TRACE_GRAVITY);
+    put_u32(col_begin);
+    put_u32(col_end);
+}
+
+void TraceWriter::power_up(int cells) {
+    put_u8(TRACE_POWER_UP);
+    put_u32(cells);
+}
+
+void TraceWriter::gravity_mode(bool on) {
+    put_u8(TRACE_GRAVITY_MODE);
+    put_u8(on ? 1 : 0);
+}
+
+void TraceWriter::end_command(BlockFall &game) {
+    if (game.current_score != last_score) {
+        last_score = game.current_score;
+        put_u8(TRACE_SCORE);
+        put_u64(last_score);
+    }
+    if (placements_since_keyframe >= (uint32_t) keyframe_interval) {
+        // Rows outside the dirty region already match the shadow
+        keyframe(game);
+        sync_shadow(game.grid, game.dirty_trace.row_begin, game.dirty_trace.row_end);
+    } else if (!game.dirty_trace.empty()) {
+        delta(game, game.dirty_trace);
+    }
+    game.dirty_trace.clear();
+    if (buffer.size() >= TRACE_BUFFER_BYTES) {
+        flush();
+    }
+}
+
+void TraceWriter::game_end(const BlockFall &game, GameEnd end) {
+    put_u8(TRACE_GAME_END);
+    put_u8(end);
+    put_u64(game.current_score);
+    flush();
+}
+
+void TraceWriter::keyframe(const BlockFall &game) {
+    placements_since_keyframe = 0;
+    changed_rows.clear();
+    game.grid.for_each_occupied_row([&](int r) {
+        const GridWord *row = game.grid.row(r);
+        for (int w = 0; w < game.grid.stride; ++w) {
+            if (row[w] != 0) {
+                changed_rows.push_back(r);
+                break;
+            }
+        }
+    });
+    put_u8(TRACE_KEYFRAME);
+    put_u32(changed_rows.size());
+    for (int r: changed_rows) {
+        put_u32(r);
+        put_bits(game.grid, r, 0, game.cols);
+    }
+}
+
+void TraceWriter::sync_shadow(const Grid &grid, int row_begin, int row_end) {
+    // A row can only differ from the shadow if one of the two may hold cells
+    changed_rows.clear();
+    size_t row_bytes = grid.stride * sizeof(GridWord);
+    bool emptied = false;
+    for (int r = row_begin; r < row_end; ++r) {
+        if (!grid.row_occupied(r) && !shadow.row_occupied(r)) {
+            continue;
+        }
+        if (memcmp(grid.row(r), shadow.row(r), row_bytes) != 0) {
+            changed_rows.push_back(r);
+            memcpy(shadow.write_row(r), grid.row(r), row_bytes);
+            emptied = emptied || !grid.row_occupied(r);
+        }
+    }
+    if (emptied) {
+        // Without this the stale bits of cleared rows would be compared on every later sync
+        shadow.trim(row_begin / GRID_TILE_ROWS, (row_end + GRID_TILE_ROWS - 1) / GRID_TILE_ROWS);
+    }
+}
+
+void TraceWriter::delta(const BlockFall &game, const DirtyRegion &region) {
+    sync_shadow(game.grid, region.row_begin, region.row_end);
+    if (changed_rows.empty()) {
+        return;
+    }
+    put_u8(TRACE_DELTA);
+    put_u32(region.col_begin);
+    put_u32(region.col_end);
+    put_u32(changed_rows.size());
+    for (int r: changed_rows) {
+        put_u32(r);
+        put_bits(game.grid, r, region.col_begin, region.col_end);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef PA2_TRACEWRITER_H
+#define PA2_TRACEWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BlockFall.h"
+#include "GameController.h"
+#include "Grid.h"
+
+#ifdef BLOCKFALL_TRACE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+// Record types of a binary game trace. A trace starts with the header
+//   "BFTR", u16 version, u16 flags (bit 0: gravity on), u32 rows, u32 cols, u32 keyframe interval
+// followed by records, each a u8 type and its fields. Integers are little-endian.
+enum TraceRecord : uint8_t {
+    TRACE_PLACEMENT = 1,    // u32 block number, u32 x, u32 y, u8 rotation index - a block settles
+    TRACE_ROWS_CLEARED = 2, // u32 count, u32 row * count - full rows, before they are removed
+    TRACE_GRAVITY = 3,      // u32 col_begin, u32 col_end - columns compacted by gravity
+    TRACE_POWER_UP = 4,     // u32 cells cleared
+    TRACE_SCORE = 5,        // u64 score, written when it changed during a command
+    TRACE_DELTA = 6,        // u32 col_begin, u32 col_end, u32 count, (u32 row, bits) * count
+    TRACE_KEYFRAME = 7,     // u32 count, (u32 row, bits) * count - every other row is empty
+    TRACE_GAME_END = 8,     // u8 GameEnd, u64 score
+    TRACE_GRAVITY_MODE = 9  // u8 on
+};
+
+// Binary replacement for the grid dumps. Event records are written as they happen; the grid
+// itself is written once per command as a delta of the rows that changed, restricted to the
+// columns that may have changed (bits, one per cell, low bit first). Every keyframe_interval
+// placements a keyframe lists all non-empty rows instead, so a reader can start from there.
+// Work and output are bounded by the changed region (keyframes by the filled rows), not by the
+// grid size.
+//
+// Output goes through an in-memory buffer to a file, or to a gzip stream when the writer is
+// built with BLOCKFALL_TRACE_ZLIB (link with -lz) and compress is set.
+class TraceWriter {
+public:
+    TraceWriter(const string &file_name, bool compress = false, int keyframe_interval = 64);
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+    ~TraceWriter(); // Flushes and closes
+
+    bool is_open() const;
+
+    bool started = false; // Header and first keyframe written
+
+    void begin_game(const BlockFall &game);
+
+    void placement(const BlockFall &game);
+
+    void rows_cleared(const BlockFall &game); // Call while the full rows are still in the grid
+
+    void gravity(int col_begin, int col_end);
+
+    void power_up(int cells);
+
+    void gravity_mode(bool on);
+
+    void end_command(BlockFall &game); // Score and grid delta of everything since the last call
+
+    void game_end(const BlockFall &game, GameEnd end);
+
+    void flush();
+
+private:
+    FILE *file = nullptr;
+#ifdef BLOCKFALL_TRACE_ZLIB
+    gzFile gz = nullptr;
+#endif
+    vector<uint8_t> buffer;
+    Grid shadow;                  // Grid as of the last delta or keyframe
+    unsigned long last_score = 0; // Score as of the last TRACE_SCORE
+    int keyframe_interval;
+    uint32_t placements = 0;
+    uint32_t placements_since_keyframe = 0;
+    vector<int> changed_rows;     // Scratch for deltas
+
+    void put_u8(uint8_t value);
+    void put_u16(uint16_t value);
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_bits(const Grid &grid, int row, int col_begin, int col_end);
+
+    void keyframe(const BlockFall &game);
+    // Copies the rows of [row_begin, row_end) that differ into the shadow and lists them in
+    // changed_rows. Rows emptied this way are trimmed from the shadow, like the live grid's
+    void sync_shadow(const Grid &grid, int row_begin, int row_end);
+    void delta(const BlockFall &game, const DirtyRegion &region);
+};
+
+#endif //PA2_TRACEWRITER_H
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int worker_count) {
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+    for (int i = 0; i < worker_count; ++i) {
+        workers.push_back(unique_ptr<Worker>(new Worker()));
+    }
+    // Threads start only once every worker exists, so none of them sees a half-built vector
+    for (unique_ptr<Worker> &worker: workers) {
+        Worker *w = worker.get();
+        w->runner = thread([w]() { run(*w); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    for (unique_ptr<Worker> &worker: workers) {
+        lock_guard<mutex> guard(worker->lock);
+        worker->stopping = true;
+        worker->wake.notify_one();
+    }
+    for (unique_ptr<Worker> &worker: workers) {
+        worker->runner.join();
+    }
+}
+
+int WorkerPool::size() const {
+    return workers.size();
+}
+
+void WorkerPool::submit(int worker, function<void()> job) {
+    Worker &w = *workers[worker % workers.size()];
+    lock_guard<mutex> guard(w.lock);
+    if (w.job_count == w.jobs.size()) {
+        vector<function<void()>> grown(max((size_t) 16, 2 * w.jobs.size()));
+        for (size_t k = 0; k < w.job_count; ++k) {
+            grown[k] = std::move(w.jobs[(w.first_job + k) % w.jobs.size()]);
+        }
+        w.jobs.swap(grown);
+        w.first_job = 0;
+    }
+    w.jobs[(w.first_job + w.job_count++) % w.jobs.size()] = std::move(job);
+    w.wake.notify_one();
+}
+
+void WorkerPool::parallel_for(int count, const function<void(int)> &fn) {
+    struct Shared {
+        const function<void(int)> *fn;
+        mutex lock;
+        condition_variable done;
+        int remaining;
+    } shared{&fn, {}, {}, count - 1};
+    for (int i = 1; i < count; ++i) {
+        // A pointer and an int fit in std::function's inline storage, so queuing a task does not allocate
+        Shared *state = &shared;
+        submit(i, [state, i]() {
+            (*state->fn)(i);
+            lock_guard<mutex> guard(state->lock);
+            if (--state->remaining == 0) {
+                state->done.notify_one();
+            }
+        });
+    }
+    if (count > 0) {
+        fn(0);
+    }
+    unique_lock<mutex> guard(shared.lock);
+    shared.done.wait(guard, [&shared]() { return shared.remaining <= 0; });
+}
+
+void WorkerPool::run(Worker &worker) {
+    unique_lock<mutex> guard(worker.lock);
+    while (true) {
+        worker.wake.wait(guard, [&worker]() { return worker.stopping || worker.job_count > 0; });
+        if (worker.job_count == 0) {
+            return; // Stopping and drained
+        }
+        function<void()> job = std::move(worker.jobs[worker.first_job]);
+        worker.first_job = (worker.first_job + 1) % worker.jobs.size();
+        worker.job_count--;
+        guard.unlock();
+        job();
+        guard.lock();
+    }
+}
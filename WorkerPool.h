@@ -0,0 +1,48 @@
+#ifndef PA2_WORKERPOOL_H
+#define PA2_WORKERPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of threads, each with its own job queue. Jobs submitted to the same worker run one at
+// a time in submission order, so state owned by one worker needs no locking.
+class WorkerPool {
+public:
+    explicit WorkerPool(int worker_count);
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    ~WorkerPool(); // Runs every job already submitted, then joins the threads
+
+    int size() const;
+
+    void submit(int worker, function<void()> job);
+
+    // Runs fn(0) .. fn(count - 1) and returns when all are done. Task 0 runs on the calling
+    // thread, task i on worker i % size(). Must not be called from a job of the same pool.
+    void parallel_for(int count, const function<void(int)> &fn);
+
+private:
+    // Jobs are kept in a ring that only grows when it is full, so a steady stream of jobs (the
+    // kernels' parallel passes) does not allocate
+    struct Worker {
+        thread runner;
+        mutex lock;
+        condition_variable wake;
+        vector<function<void()>> jobs; // Ring of jobs.size() slots
+        size_t first_job = 0;
+        size_t job_count = 0;
+        bool stopping = false;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+
+    static void run(Worker &worker);
+};
+
+#endif //PA2_WORKERPOOL_H
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include "../AllocationCounter.h"
+#include "../DifferentialHarness.h"
+
+// Replays the differential harness cases through a prepared GameController and checks that the
+// command loop makes no heap allocation, first with the kernels on the calling thread and then
+// with every full-width pass split over several threads. Needs -DBLOCKFALL_COUNT_ALLOCATIONS
+// (run_tests.sh sets it); without it the check is skipped. Exits with 1 on the first case whose
+// loop allocated.
+
+const uint64_t FIRST_SEED = 1;
+const int CASE_COUNT = 300;
+
+int main() {
+    if (!AllocationCounter::enabled()) {
+        cout << "Allocations: not counted, build with -DBLOCKFALL_COUNT_ALLOCATIONS" << endl;
+        return 0;
+    }
+
+    DifferentialHarness harness;
+    ostream silent(nullptr);
+    int threaded = max(4, (int) thread::hardware_concurrency());
+    for (int threads: {1, threaded}) {
+        GridKernels::set_parallel(threads, 0);
+        for (int c = 0; c < CASE_COUNT; ++c) {
+            FuzzCase fuzz_case = harness.generate(FIRST_SEED + c);
+            BlockFall game(GameSetup::create(fuzz_case.grid, fuzz_case.shapes), fuzz_case.gravity_mode_on, "", "check");
+            GameController controller;
+            controller.output = &silent;
+            CommandScript script;
+            script.commands = fuzz_case.commands;
+            controller.prepare(game); // What play() does with allocation_free before a file's first command
+            controller.play(game, script);
+            if (controller.loop_allocations != 0) {
+                cout << "Allocations: " << controller.loop_allocations << " in the command loop on seed "
+                     << fuzz_case.seed << " with " << threads << " kernel threads" << endl;
+                return 1;
+            }
+        }
+    }
+    GridKernels::set_parallel(1, 0);
+    cout << "Allocations: none in the command loop on " << CASE_COUNT << " cases, with 1 and " << threaded
+         << " kernel threads" << endl;
+    return 0;
+}
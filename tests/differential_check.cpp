@@ -0,0 +1,34 @@
+#include <iostream>
+#include "../DifferentialHarness.h"
+
+// Runs DifferentialHarness::check: every kernel configuration of GameController against
+// ReferenceEngine, state hashes compared after every command. The default limits include grids
+// taller than one tile and wide enough for several column slices, and one configuration runs the
+// kernels on several threads. Exits with 1 if any configuration diverges or a case class is missing.
+
+const uint64_t FIRST_SEED = 1;
+const int CASE_COUNT = 300;
+
+int main() {
+    DifferentialHarness harness;
+
+    bool threaded = false;
+    for (const HarnessEngine &engine: harness.engines) {
+        threaded = threaded || engine.threads > 1;
+    }
+    int tall = 0;
+    int wide = 0;
+    for (int c = 0; c < CASE_COUNT; ++c) {
+        FuzzCase fuzz_case = harness.generate(FIRST_SEED + c);
+        tall += (int) fuzz_case.grid.size() > GRID_TILE_ROWS;
+        wide += (int) fuzz_case.grid[0].size() > harness.limits.small_cols;
+    }
+    cout << "Cases: " << tall << " taller than one tile, " << wide << " wider than " << harness.limits.small_cols
+         << " columns" << endl;
+    if (!threaded || tall == 0 || wide == 0) {
+        cout << "Differential check: no multi-threaded engine or no tall/wide cases" << endl;
+        return 1;
+    }
+
+    return harness.check(FIRST_SEED, CASE_COUNT, "", cout) ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include "../BlockFall.h"
+#include "../GameController.h"
+#include "../GridKernels.h"
+
+// Plays random games and compares the incrementally kept BlockFall::features with a full
+// BoardFeatures::reset after every command. Grids go past one 64-row tile and past one cache line
+// of columns, and every other game splits its passes over several threads. Exits with 1 on the
+// first mismatch.
+
+const int GAME_COUNT = 120;
+
+static int draw(mt19937_64 &rng, int low, int high) {
+    return low + (int) (rng() % (uint64_t) (high - low + 1));
+}
+
+static void write_shape(ostream &out, mt19937_64 &rng, int max_side) {
+    int height = draw(rng, 1, max_side);
+    int width = draw(rng, 1, max_side);
+    for (int i = 0; i < height; ++i) {
+        out << (i == 0 ? "[" : "");
+        for (int j = 0; j < width; ++j) {
+            out << (j == 0 ? "" : " ") << (i == 0 && j == 0 ? 1 : draw(rng, 0, 99) < 60);
+        }
+        out << (i + 1 == height ? "]" : "") << endl;
+    }
+    out << endl;
+}
+
+static bool same_features(const BoardFeatures &kept, const BoardFeatures &fresh, const Grid &grid) {
+    if (kept.aggregate_height() != fresh.aggregate_height() || kept.holes() != fresh.holes() ||
+        kept.bumpiness() != fresh.bumpiness() || kept.well_sum() != fresh.well_sum()) {
+        return false;
+    }
+    for (int c = 0; c < grid.cols; ++c) {
+        if (kept.column_height(c) != fresh.column_height(c) || kept.column_holes(c) != fresh.column_holes(c) ||
+            kept.well_depth(c) != fresh.well_depth(c)) {
+            return false;
+        }
+    }
+    for (int r = 0; r < grid.rows; ++r) {
+        if (kept.row_fill(r) != fresh.row_fill(r)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns false and prints the game and command on the first mismatch
+static bool play_game(int index) {
+    mt19937_64 rng(index + 1);
+    static const int widths[] = {8, 10, 16, 63, 64, 65, 130, 200, 520};
+    int rows = draw(rng, 0, 2) == 0 ? draw(rng, 4, 40) : draw(rng, 60, 200);
+    int cols = widths[draw(rng, 0, 8)];
+
+    ofstream grid_file("features_grid.txt");
+    for (int i = 0; i < rows; ++i) {
+        int density = i < rows / 2 ? 0 : draw(rng, 0, 9) == 0 ? 100 : draw(rng, 20, 90);
+        for (int j = 0; j < cols; ++j) {
+            grid_file << (j == 0 ? "" : " ") << (draw(rng, 0, 99) < density);
+        }
+        grid_file << endl;
+    }
+    grid_file.close();
+    ofstream blocks_file("features_blocks.txt");
+    int block_count = draw(rng, 2, 12);
+    for (int b = 0; b <= block_count; ++b) {
+        write_shape(blocks_file, rng, b == block_count ? 3 : 4); // The last one is the power-up
+    }
+    blocks_file.close();
+
+    GridKernels::set_parallel(index % 2 == 0 ? 1 : 4, 0);
+    BlockFall game("features_grid.txt", "features_blocks.txt", draw(rng, 0, 3) == 0, "", "check");
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+
+    static const GameCommand commands[] = {CMD_MOVE_LEFT, CMD_MOVE_RIGHT, CMD_MOVE_RIGHT, CMD_ROTATE_RIGHT,
+                                           CMD_ROTATE_LEFT, CMD_DROP, CMD_DROP, CMD_SOFT_DROP, CMD_GRAVITY_SWITCH};
+    for (int step = 1; step <= 400 && !game.game_over && game.has_next_block(game); ++step) {
+        GameCommand command = commands[draw(rng, 0, 8)];
+        if (command == CMD_MOVE_RIGHT) {
+            for (int moves = draw(rng, 0, cols / 4); moves > 0; --moves) {
+                controller.apply_command(game, command);
+            }
+        }
+        controller.apply_command(game, command);
+        BoardFeatures fresh;
+        fresh.reset(game.grid);
+        if (!same_features(game.features, fresh, game.grid)) {
+            cout << "Features: MISMATCH with a full recompute in game " << index << " (" << rows << "x" << cols
+                 << ") after command " << step << " (command " << command << ")" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    for (int index = 0; index < GAME_COUNT; ++index) {
+        if (!play_game(index)) {
+            return 1;
+        }
+    }
+    GridKernels::set_parallel(1, 0);
+    cout << "Features: match a full recompute after every command of " << GAME_COUNT << " games" << endl;
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include "../LeaderboardHistory.h"
+
+// Feeds random results to a LeaderboardHistory, one at a time and in bulk, with repeated times and
+// scores, and after every batch compares each query with a brute-force scan of every result so
+// far: per-player stats and results by time window, results by time window, and ranks by score.
+// Enough results go in for the blocks to split many times. Exits with 1 on the first mismatch.
+
+const int BATCH_COUNT = 40;
+const int BATCH_SIZE = 1000;
+const int PLAYER_COUNT = 12;
+
+static bool same(const vector<HistoryResult> &a, const vector<HistoryResult> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].score != b[i].score || a[i].last_played != b[i].last_played || a[i].player_id != b[i].player_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Results of player (or of everyone, with player -1) played in [from, to), oldest first; equal
+// times keep the order they were added in
+static vector<HistoryResult> scan(const vector<HistoryResult> &all, int player, time_t from, time_t to) {
+    vector<HistoryResult> found;
+    for (const HistoryResult &result: all) {
+        if ((player < 0 || result.player_id == (uint32_t) player) && result.last_played >= from &&
+            result.last_played < to) {
+            found.push_back(result);
+        }
+    }
+    stable_sort(found.begin(), found.end(), [](const HistoryResult &a, const HistoryResult &b) {
+        return a.last_played < b.last_played;
+    });
+    return found;
+}
+
+static bool check(const LeaderboardHistory &history, const vector<HistoryResult> &all, mt19937_64 &rng) {
+    if (history.size() != all.size()) {
+        return false;
+    }
+    for (int p = 0; p < PLAYER_COUNT; ++p) {
+        vector<HistoryResult> expected = scan(all, p, 0, 1 << 20);
+        const PlayerStats *stats = history.player(p);
+        if (expected.empty()) {
+            if (stats != nullptr) {
+                return false;
+            }
+            continue;
+        }
+        unsigned long best = 0;
+        for (const HistoryResult &result: expected) {
+            best = max(best, result.score);
+        }
+        if (stats == nullptr || stats->games != expected.size() || stats->best_score != best) {
+            return false;
+        }
+        time_t from = rng() % 8000;
+        time_t to = from + rng() % 2000;
+        vector<HistoryResult> got;
+        history.results_between(p, from, to, got);
+        if (!same(got, scan(all, p, from, to))) {
+            return false;
+        }
+    }
+    for (int q = 0; q < 20; ++q) {
+        time_t from = rng() % 8000;
+        time_t to = from + rng() % 1000;
+        vector<HistoryResult> got;
+        history.results_between(from, to, got);
+        if (!same(got, scan(all, -1, from, to))) {
+            return false;
+        }
+
+        unsigned long score = rng() % 600;
+        size_t below = count_if(all.begin(), all.end(), [score](const HistoryResult &result) {
+            return result.score < score;
+        });
+        if (history.count_below(score) != below || history.percentile(score) != 100.0 * below / all.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    mt19937_64 rng(11);
+    LeaderboardHistory history;
+    vector<HistoryResult> all; // Every result, in the order it was added
+    for (int batch = 0; batch < BATCH_COUNT; ++batch) {
+        // Times mostly rise, like real games, with some out of order; scores repeat a lot. The last
+        // player never plays, so player() has to report nobody
+        vector<HistoryResult> results;
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            time_t played = batch * 100 + rng() % 150 + (rng() % 10 == 0 ? rng() % 4000 : 0);
+            results.push_back(HistoryResult{rng() % 500, played, (uint32_t) (rng() % (PLAYER_COUNT - 1))});
+        }
+        if (batch % 3 == 0) {
+            history.add_all(results);
+        } else {
+            for (const HistoryResult &result: results) {
+                history.add(result.score, result.last_played, result.player_id);
+            }
+        }
+        all.insert(all.end(), results.begin(), results.end());
+        if (!check(history, all, rng)) {
+            cout << "History: a query disagrees with a scan of every result after batch " << batch << endl;
+            return 1;
+        }
+    }
+    cout << "History: player, time window and score queries match a full scan over " << all.size() << " results"
+         << endl;
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "../GameHost.h"
+
+// Runs a GameHost on a socket in the scratch directory and drives two sessions from two
+// connections. Checks that each session scores like the same commands played locally, that a
+// connection cannot send commands to or close the other's session, and that a session left open
+// when its client hangs up still reaches the host leaderboard. Linux only: elsewhere the check is
+// skipped. Exits with 1 on the first failure.
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const char *SOCKET_PATH = "host_check.sock";
+
+static shared_ptr<const GameSetup> make_setup() {
+    vector<vector<int>> cells(12, vector<int>(8, 0));
+    for (int j = 0; j < 7; ++j) {
+        cells[11][j] = 1; // One gap in the last column
+    }
+    vector<vector<vector<bool>>> shapes = {
+            {{true}, {true}},
+            {{true, true, true}},
+            {{true, true}, {true, true}},
+            {{true, true}, {true, true}} // Power-up
+    };
+    return GameSetup::create(cells, shapes);
+}
+
+static int connect_host() {
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, SOCKET_PATH, sizeof(address.sun_path) - 1);
+        if (connect(fd, (sockaddr *) &address, sizeof(address)) == 0) {
+            return fd;
+        }
+        close(fd);
+        this_thread::sleep_for(chrono::milliseconds(10)); // The host may not be listening yet
+    }
+    return -1;
+}
+
+// Sends one request and waits for its reply. False if the connection failed
+static bool request(int fd, uint8_t type, uint32_t session, const string &payload, HostReply &reply) {
+    HostRequestHeader header{type, 0, (uint16_t) payload.size(), session};
+    string message((const char *) &header, sizeof(header));
+    message += payload;
+    if (send(fd, message.data(), message.size(), MSG_NOSIGNAL) != (ssize_t) message.size()) {
+        return false;
+    }
+    char *data = (char *) &reply;
+    size_t received = 0;
+    while (received < sizeof(reply)) {
+        ssize_t count = recv(fd, data + received, sizeof(reply) - received, 0);
+        if (count <= 0) {
+            return false;
+        }
+        received += count;
+    }
+    return true;
+}
+
+// Score of the commands played locally from the same setup
+static unsigned long local_score(const shared_ptr<const GameSetup> &setup, const string &commands) {
+    BlockFall game(setup, false, "", "local");
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+    for (char command: commands) {
+        if (game.game_over || !game.has_next_block(game)) {
+            break;
+        }
+        controller.apply_command(game, (GameCommand) command);
+    }
+    return game.current_score;
+}
+
+static bool fail(const string &message) {
+    cout << "Host: " << message << endl;
+    return false;
+}
+
+static bool check(const shared_ptr<const GameSetup> &setup) {
+    int first = connect_host();
+    int second = connect_host();
+    if (first < 0 || second < 0) {
+        return fail("unable to connect");
+    }
+
+    HostReply reply{};
+    string open_payload = string(1, 0) + string(1, 0);
+    if (!request(first, MSG_OPEN, 0, open_payload + "first", reply) || reply.status != STATUS_OK) {
+        return fail("the first session did not open");
+    }
+    uint32_t first_id = reply.session;
+    if (!request(second, MSG_OPEN, 0, open_payload + "second", reply) || reply.status != STATUS_OK) {
+        return fail("the second session did not open");
+    }
+    uint32_t second_id = reply.session;
+
+    string first_commands = string(7, CMD_MOVE_RIGHT) + string(1, CMD_DROP);
+    string second_commands = string(1, CMD_MOVE_RIGHT) + string(1, CMD_ROTATE_RIGHT) + string(1, CMD_DROP);
+    if (!request(first, MSG_COMMANDS, first_id, first_commands, reply) || reply.status != STATUS_OK ||
+        reply.score != local_score(setup, first_commands)) {
+        return fail("the first session did not score like a local game");
+    }
+    if (!request(second, MSG_COMMANDS, second_id, second_commands, reply) || reply.status != STATUS_OK ||
+        reply.score != local_score(setup, second_commands)) {
+        return fail("the second session did not score like a local game");
+    }
+    unsigned long second_score = reply.score;
+
+    // Each connection tries the other's session, and nothing it sends reaches that session
+    if (!request(first, MSG_COMMANDS, second_id, string(1, CMD_DROP), reply) || reply.status != STATUS_NO_SESSION ||
+        !request(first, MSG_CLOSE, second_id, "", reply) || reply.status != STATUS_NO_SESSION ||
+        !request(second, MSG_CLOSE, first_id, "", reply) || reply.status != STATUS_NO_SESSION) {
+        return fail("a connection reached a session it did not open");
+    }
+    if (!request(second, MSG_COMMANDS, second_id, "", reply) || reply.status != STATUS_OK ||
+        reply.state != STATE_PLAYING || reply.score != second_score) {
+        return fail("the refused requests changed the second session");
+    }
+
+    // The first client hangs up with its session open; the second closes its own
+    close(first);
+    this_thread::sleep_for(chrono::milliseconds(100)); // Lets the host see the hang-up before stop()
+    if (!request(second, MSG_CLOSE, second_id, "", reply) || reply.status != STATUS_OK ||
+        !request(second, MSG_COMMANDS, second_id, "", reply) || reply.status != STATUS_NO_SESSION) {
+        return fail("the second session did not close");
+    }
+    close(second);
+    return true;
+}
+
+int main() {
+    shared_ptr<const GameSetup> setup = make_setup();
+    GameHost host(SOCKET_PATH, 2, "");
+    host.add_setup(setup);
+    bool served = false;
+    thread runner([&]() { served = host.run(); });
+
+    bool ok = check(setup);
+    host.stop();
+    runner.join();
+    if (!ok) {
+        return 1;
+    }
+    if (!served) {
+        cout << "Host: run() failed" << endl;
+        return 1;
+    }
+
+    // Both games are recorded once: the hung-up one by its teardown, the other by MSG_CLOSE
+    int first_entries = 0;
+    int second_entries = 0;
+    for (LeaderboardEntry *entry = host.leaderboard.head_leaderboard_entry; entry != nullptr;
+         entry = entry->next_leaderboard_entry) {
+        first_entries += host.leaderboard.player_name(entry) == "first";
+        second_entries += host.leaderboard.player_name(entry) == "second";
+    }
+    if (first_entries != 1 || second_entries != 1) {
+        cout << "Host: the leaderboard holds " << first_entries << " first and " << second_entries
+             << " second entries, expected one each" << endl;
+        return 1;
+    }
+    cout << "Host: sessions stay with their connection and end on hang-up" << endl;
+    return 0;
+}
+
+#else
+
+int main() {
+    cout << "Host: not checked, the game host is Linux only" << endl;
+    return 0;
+}
+
+#endif
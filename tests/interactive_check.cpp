@@ -0,0 +1,139 @@
+#include <iostream>
+#include <random>
+#include <unistd.h>
+#include "../GameSetup.h"
+#include "../InteractiveController.h"
+
+// Feeds keys to InteractiveController::read_keys through a pipe, cut into reads of random length so
+// arrow-key escape sequences get split, and checks the game against a twin driven by
+// GameController::apply_command with the commands the keys stand for. Linux only: elsewhere the
+// check is skipped. Exits with 1 on the first difference.
+
+#ifdef __linux__
+
+const int ROUND_COUNT = 200;
+
+static BlockFall make_game() {
+    vector<vector<int>> cells(24, vector<int>(12, 0));
+    for (int j = 0; j < 11; ++j) {
+        cells[23][j] = 1; // One gap, so drops into it clear a row
+    }
+    vector<vector<vector<bool>>> shapes = {
+            {{true, true, true}},
+            {{true, false}, {true, true}},
+            {{true}, {true}},
+            {{true, true}, {true, true}},
+            {{true, true}, {true, true}} // Power-up
+    };
+    return BlockFall(GameSetup::create(cells, shapes), false, "", "check");
+}
+
+static bool same_game(const BlockFall &keyed, const BlockFall &twin, GameController &controller) {
+    if (keyed.current_score != twin.current_score || keyed.x_offset != twin.x_offset ||
+        keyed.y_offset != twin.y_offset || keyed.game_over != twin.game_over ||
+        (keyed.active_rotation != nullptr) != (twin.active_rotation != nullptr)) {
+        return false;
+    }
+    string keyed_row;
+    string twin_row;
+    for (int i = 0; i < keyed.rows; ++i) {
+        controller.render_row(keyed, i, keyed_row);
+        controller.render_row(twin, i, twin_row);
+        if (keyed_row != twin_row) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    struct Key {
+        const char *bytes;
+        GameCommand command;
+    };
+    static const Key keys[] = {{"a", CMD_MOVE_LEFT}, {"d", CMD_MOVE_RIGHT}, {"w", CMD_ROTATE_RIGHT},
+                               {"z", CMD_ROTATE_LEFT}, {"s", CMD_SOFT_DROP}, {" ", CMD_DROP},
+                               {"g", CMD_GRAVITY_SWITCH}, {"\x1b[A", CMD_ROTATE_RIGHT},
+                               {"\x1b[B", CMD_SOFT_DROP}, {"\x1b[C", CMD_MOVE_RIGHT}, {"\x1b[D", CMD_MOVE_LEFT}};
+    const int key_kinds = sizeof(keys) / sizeof(keys[0]);
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        cout << "Interactive: unable to create a pipe" << endl;
+        return 1;
+    }
+    ostream silent(nullptr);
+    GameController controller;
+    controller.output = &silent;
+    mt19937_64 rng(7);
+    int quit_rounds = 0;
+
+    for (int round = 0; round < ROUND_COUNT; ++round) {
+        BlockFall keyed = make_game();
+        BlockFall twin = make_game();
+        InteractiveController interactive;
+        string stream;
+        for (int k = 0; k < 40; ++k) {
+            const Key &key = keys[rng() % key_kinds];
+            stream += key.bytes;
+            if (!twin.game_over && twin.has_next_block(twin)) {
+                controller.apply_command(twin, key.command);
+            }
+        }
+
+        bool quit = false;
+        for (size_t sent = 0; sent < stream.size();) {
+            size_t length = min(stream.size() - sent, (size_t) (1 + rng() % 4));
+            if (write(pipe_fds[1], stream.data() + sent, length) != (ssize_t) length ||
+                !interactive.read_keys(keyed, pipe_fds[0], quit)) {
+                cout << "Interactive: the pipe failed in round " << round << endl;
+                return 1;
+            }
+            sent += length;
+        }
+        if (quit || !same_game(keyed, twin, controller)) {
+            cout << "Interactive: keys and commands disagree in round " << round << endl;
+            return 1;
+        }
+
+        // q ends a running game and nothing after it is applied
+        if (keyed.game_over || !keyed.has_next_block(keyed)) {
+            continue;
+        }
+        ++quit_rounds;
+        int x_offset = keyed.x_offset;
+        if (write(pipe_fds[1], "q", 1) != 1 || !interactive.read_keys(keyed, pipe_fds[0], quit) || !quit ||
+            write(pipe_fds[1], "a", 1) != 1 || !interactive.read_keys(keyed, pipe_fds[0], quit) ||
+            keyed.x_offset != x_offset) {
+            cout << "Interactive: q did not stop the game in round " << round << endl;
+            return 1;
+        }
+    }
+
+    if (quit_rounds == 0) {
+        cout << "Interactive: every game ended before q could be checked" << endl;
+        return 1;
+    }
+
+    close(pipe_fds[1]);
+    bool quit = false;
+    InteractiveController interactive;
+    BlockFall game = make_game();
+    if (interactive.read_keys(game, pipe_fds[0], quit)) {
+        cout << "Interactive: a closed pipe was not reported" << endl;
+        return 1;
+    }
+    close(pipe_fds[0]);
+    cout << "Interactive: keys match their commands over " << ROUND_COUNT << " split key streams, q checked in "
+         << quit_rounds << endl;
+    return 0;
+}
+
+#else
+
+int main() {
+    cout << "Interactive: not checked, interactive mode is Linux only" << endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include "../AllocationCounter.h"
+#include "../Leaderboard.h"
+
+// Checks the leaderboard's name table and entry pool: names intern to one stable id each, entries
+// carry names through a file round trip, entries that fall off the list go back to the pool and are
+// handed out again, and a warm pool takes no new slab (no heap allocation, when counted). Exits with
+// 1 on the first failure.
+
+static bool fail(const string &message) {
+    cout << "Leaderboard: " << message << endl;
+    return false;
+}
+
+static bool check_interning() {
+    Leaderboard leaderboard;
+    uint32_t alice = leaderboard.intern("alice");
+    uint32_t bob = leaderboard.intern("bob");
+    if (alice == bob || leaderboard.intern("alice") != alice || leaderboard.find_player("bob") != (int) bob ||
+        leaderboard.find_player("carol") != -1) {
+        return fail("names do not map to one id each");
+    }
+
+    // Every entry of a name shares its id, and the id survives the file round trip and clear()
+    LeaderboardEntry *first = leaderboard.create_entry(10, 100, "alice");
+    LeaderboardEntry *second = leaderboard.create_entry(20, 200, "alice");
+    if (first->player_id != alice || second->player_id != alice || leaderboard.player_name(first) != "alice") {
+        return fail("entries do not refer to their interned name");
+    }
+    leaderboard.insert_new_entry(first);
+    leaderboard.insert_new_entry(second);
+    leaderboard.insert_new_entry(leaderboard.create_entry(15, 150, "bob"));
+    leaderboard.write_to_file("leaderboard_check.txt");
+
+    Leaderboard loaded;
+    loaded.read_from_file("leaderboard_check.txt");
+    string names;
+    for (LeaderboardEntry *entry = loaded.head_leaderboard_entry; entry != nullptr;
+         entry = entry->next_leaderboard_entry) {
+        names += loaded.player_name(entry) + " ";
+    }
+    int loaded_alice = loaded.find_player("alice");
+    if (names != "alice bob alice " || loaded_alice < 0 ||
+        loaded.head_leaderboard_entry->player_id != (uint32_t) loaded_alice ||
+        loaded.history.player(loaded_alice) == nullptr || loaded.history.player(loaded_alice)->games != 2) {
+        return fail("names did not come back from the file as one player each");
+    }
+    loaded.clear();
+    if (loaded.head_leaderboard_entry != nullptr || loaded.history.size() != 0 ||
+        loaded.intern("alice") != (uint32_t) loaded_alice) {
+        return fail("clear() did not empty the list and history or lost a name id");
+    }
+    return true;
+}
+
+static bool check_pool() {
+    Leaderboard leaderboard;
+    LeaderboardEntry *entry = leaderboard.create_entry(1, 1, "p");
+    leaderboard.release_entry(entry);
+    if (leaderboard.create_entry(2, 2, "p") != entry) {
+        return fail("a released entry was not handed out again");
+    }
+    leaderboard.release_entry(entry);
+
+    // A full list pushes an entry out on every insert and that entry goes back to the pool, so one
+    // slab serves any number of inserts
+    mt19937_64 rng(5);
+    leaderboard.reserve_entries(MAX_LEADERBOARD_SIZE + 1);
+    for (int i = 0; i < MAX_LEADERBOARD_SIZE; ++i) {
+        leaderboard.insert_into_list(leaderboard.create_entry(rng() % 1000, i, "p" + to_string(i)));
+    }
+    unsigned long allocations = AllocationCounter::allocations();
+    for (int i = 0; i < 100000; ++i) {
+        leaderboard.insert_into_list(leaderboard.create_entry(rng() % 1000, i, "p3"));
+    }
+    if (AllocationCounter::allocations() != allocations) {
+        return fail(to_string(AllocationCounter::allocations() - allocations) + " allocations in 100000 inserts");
+    }
+
+    set<LeaderboardEntry *> seen;
+    int length = 0;
+    for (int i = 0; i < 1000; ++i) {
+        LeaderboardEntry *created = leaderboard.create_entry(rng() % 1000, i, "p4");
+        seen.insert(created);
+        leaderboard.insert_into_list(created);
+    }
+    for (LeaderboardEntry *e = leaderboard.head_leaderboard_entry; e != nullptr; e = e->next_leaderboard_entry) {
+        ++length;
+    }
+    if (length != MAX_LEADERBOARD_SIZE || seen.size() > LEADERBOARD_SLAB_ENTRIES) {
+        return fail("1000 inserts used " + to_string(seen.size()) + " distinct entries for a list of " +
+                    to_string(length));
+    }
+    return true;
+}
+
+int main() {
+    if (!check_interning() || !check_pool()) {
+        return 1;
+    }
+    cout << "Leaderboard: names intern once and entries are reused from the pool" << endl;
+    return 0;
+}
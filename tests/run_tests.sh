@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds every tests/*.cpp against the game sources and runs it. Extra arguments are passed to the
+# compiler, for example -DGRID_CELL_BITS=1. Tests run in a scratch directory, so the files they
+# write stay out of the tree. Exits with 1 if any test fails to build or fails.
+cd "$(dirname "$0")/.." || exit 1
+out="${TMPDIR:-/tmp}/blockfall_tests"
+rm -rf "$out/obj"
+mkdir -p "$out/obj"
+flags="-std=c++17 -O2 -pthread -DBLOCKFALL_COUNT_ALLOCATIONS $*" # Counting is needed by allocation_check
+
+# The game sources are compiled once and linked into every test
+for source in *.cpp; do
+    echo "$source"
+done | xargs -P "$(nproc 2>/dev/null || echo 4)" -I{} sh -c "g++ $flags -c {} -o $out/obj/{}.o" || exit 1
+
+status=0
+for test in tests/*.cpp; do
+    name=$(basename "$test" .cpp)
+    if ! g++ $flags -I. "$test" "$out"/obj/*.o -o "$out/$name"; then
+        echo "FAIL $name (build)"
+        status=1
+        continue
+    fi
+    if (cd "$out" && "./$name"); then
+        echo "PASS $name"
+    else
+        echo "FAIL $name"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,92 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "../Tournament.h"
+
+// Plays a set of command files through Tournament::run twice and compares the merged leaderboard
+// file with the same files played one after another by GameController on the same file. Scores
+// and names must match row for row (times differ). Exits with 1 on the first difference.
+
+const int FILE_COUNT = 7;
+
+static const char *COMMANDS[] = {"MOVE_LEFT", "MOVE_RIGHT", "ROTATE_RIGHT", "ROTATE_LEFT", "DROP", "DROP",
+                                 "GRAVITY_SWITCH"};
+
+static void write_files(vector<string> &commands_files) {
+    mt19937_64 rng(3);
+    ofstream grid_file("tournament_grid.txt");
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            grid_file << (j == 0 ? "" : " ") << (i >= 7 && rng() % 4 != 0);
+        }
+        grid_file << endl;
+    }
+    ofstream blocks_file("tournament_blocks.txt");
+    blocks_file << "[1 1 1]\n\n[1 0\n1 1]\n\n[1\n1]\n\n[1 1\n1 1]\n\n[1 1\n1 1]\n";
+
+    for (int f = 0; f < FILE_COUNT; ++f) {
+        commands_files.push_back("tournament_player" + to_string(f) + ".txt");
+        ofstream commands_file(commands_files.back());
+        for (int c = (int) (rng() % 30); c > 0; --c) {
+            commands_file << COMMANDS[rng() % 7] << endl;
+        }
+    }
+}
+
+static void write_leaderboard(const string &file_name) {
+    ofstream file(file_name);
+    file << "900 1700000000 alice\n300 1700000001 bob\n40 1700000002 carol\n";
+}
+
+// "score name" per row, in file order
+static string rows_of(const string &file_name) {
+    ifstream file(file_name);
+    stringstream rows;
+    unsigned long score;
+    time_t date;
+    string name;
+    while (file >> score >> date >> name) {
+        rows << score << " " << name << "\n";
+    }
+    return rows.str();
+}
+
+int main() {
+    vector<string> commands_files;
+    write_files(commands_files);
+    shared_ptr<const GameSetup> setup = GameSetup::load("tournament_grid.txt", "tournament_blocks.txt");
+
+    write_leaderboard("tournament_sequential.txt");
+    write_leaderboard("tournament_merged.txt");
+    Tournament tournament(setup, false, 3);
+    ostream silent(nullptr);
+    for (int round = 1; round <= 2; ++round) {
+        for (const string &commands_file: commands_files) {
+            string name = commands_file.substr(0, commands_file.size() - 4);
+            BlockFall game(setup, false, "tournament_sequential.txt", name);
+            GameController controller;
+            controller.output = &silent;
+            controller.play(game, commands_file);
+        }
+        tournament.run(commands_files, "tournament_merged.txt");
+
+        string sequential = rows_of("tournament_sequential.txt");
+        string merged = rows_of("tournament_merged.txt");
+        if (sequential != merged) {
+            cout << "Tournament: run " << round << " merged\n" << merged << "sequential runs gave\n" << sequential;
+            return 1;
+        }
+        stringstream in_memory;
+        for (LeaderboardEntry *entry = tournament.leaderboard.head_leaderboard_entry; entry != nullptr;
+             entry = entry->next_leaderboard_entry) {
+            in_memory << entry->score << " " << tournament.leaderboard.player_name(entry) << "\n";
+        }
+        if (in_memory.str() != merged) {
+            cout << "Tournament: run " << round << " kept\n" << in_memory.str() << "in memory, the file has\n" << merged;
+            return 1;
+        }
+    }
+    cout << "Tournament: two runs of " << FILE_COUNT << " files merge like sequential games" << endl;
+    return 0;
+}